@@ -0,0 +1,352 @@
+/* interpreter benchmarks: load time, steps, expressions, save round trips and wrapping over generated scripts */
+/* build: g++ -std=c++17 -O2 -pthread bench.cpp -o dial-bench */
+/* profile: g++ -std=c++17 -O2 -pthread -DDIAL_PROFILE bench.cpp -o dial-bench-prof, also prints where the time went and writes bench_trace.json */
+/* usage: dial-bench [--filter=text] [--min-time=seconds] [--json=file] */
+/* the JSON follows Google Benchmark's layout, so its compare.py can diff two commits' results */
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <cmath>
+#include <vector>
+#include <array>
+#include <queue>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <memory_resource>
+#include <thread>
+#include <chrono>
+#include <new>
+
+#define DIAL_QUIET
+#include "dial.hpp"
+#include "heapcount.hpp" /* the allocs column, what a step keeps (the shown text, the save data) counts too */
+
+#define u32 unsigned int
+#define elif else if
+
+using std::string;
+using std::vector;
+
+
+namespace bench {
+    struct Result {
+        string name;
+        unsigned long long iteration_c;
+        double realTime_ns;     /* per iteration */
+        double cpuTime_ns;
+        double item_c;          /* items per iteration: steps, evaluations, bytes */
+        string itemUnit;        /* "items" or "bytes" */
+        double heapAllocation_c; /* per iteration */
+    };
+
+    struct Suite {
+        string filter;
+        double minTime;
+        vector<Result> results;
+        vector<string> files; /* generated, removed at the end */
+    };
+
+    bool IsSelected (Suite* suite, const string& name) {
+        return suite->filter == "" || name.find(suite->filter) != string::npos;
+    }
+
+    /* runs body(n) with a growing n until it takes minTime, like Google Benchmark; body runs n iterations */
+    template <typename Body>
+    void Measure (Suite* suite, const string& name, double item_c, string itemUnit, Body body) {
+        if (!IsSelected(suite, name)) { return; }
+        body(1); /* warm-up: caches, counters and arenas reach their steady size */
+
+        unsigned long long n = 1;
+        while (true) {
+            unsigned long long heapAllocationStart_c = HeapAllocation_c;
+            std::clock_t cpuStart = std::clock();
+            auto timeStart = std::chrono::steady_clock::now();
+            body(n);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+            double cpuSeconds = (double)(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+            if (seconds >= suite->minTime || n >= (1ull << 30)) {
+                Result result = {name, n, seconds * 1e9 / n, cpuSeconds * 1e9 / n, item_c, itemUnit, (double)(HeapAllocation_c - heapAllocationStart_c) / n};
+                suite->results.push_back(result);
+                double rate = item_c * n / std::max(seconds, 1e-9);
+                std::cout<<std::left<<std::setw(44)<<name<<std::right<<std::fixed<<std::setprecision(0)
+                         <<std::setw(14)<<result.realTime_ns<<" ns"<<std::setw(14)<<result.cpuTime_ns<<" ns"<<std::setw(12)<<n
+                         <<std::setprecision(3)<<std::setw(12)<<((itemUnit == "bytes") ? rate / (1 << 20) : rate / 1e3)<<((itemUnit == "bytes") ? " MiB/s" : " k/s  ")
+                         <<std::setprecision(2)<<std::setw(12)<<result.heapAllocation_c<<"\n";
+                return;
+            }
+            double growth = (seconds > 0) ? std::min(10.0, std::max(2.0, 1.4 * suite->minTime / seconds)) : 10.0;
+            n = (unsigned long long)(n * growth);
+        }
+    }
+
+    void FileWrite (Suite* suite, const string& file_n, const string& text) {
+        FILE* file = fopen(file_n.c_str(), "wb");
+        fputs(text.c_str(), file);
+        fclose(file);
+        suite->files.push_back(file_n);
+    }
+
+    /* the scripts loop at [1], so a state can be stepped for as long as a benchmark needs */
+    string ConditionalScript (u32 cond_s) { /* counters, REPEAT/ONCE and nested conditionals */
+        string text = "[[1]]\n#Count++#\n";
+        for (u32 i = 0; i < cond_s; i++) {
+            switch (i % 4) {
+                case 0: text += "&Count % 7 == " + std::to_string(i % 7) + "&\n#hits++#\n||\n"; break;
+                case 1: text += "&REPEAT > " + std::to_string(i % 50) + "&\n#repeats++#\n||\n"; break;
+                case 2: text += "&ONCE&\n#firsts++#\n||\n"; break;
+                case 3: text += "&Count > 2& &hits < Count& #nested++# || ||\n"; break;
+            }
+        }
+        return text + "Step\n|\n[1]\n|~";
+    }
+
+    string NestingScript (u32 depth) { /* every conditional opens inside the previous one */
+        string text = "[[1]]\n#Count++#\n";
+        for (u32 i = 0; i < depth; i++) {
+            text += "&Count > 0 AND depth < " + std::to_string(depth * 2) + "&\n#depth += 1#\n";
+        }
+        text += "Deepest\n";
+        for (u32 i = 0; i < depth; i++) {
+            text += "||\n";
+        }
+        return text + "#depth = 0#\nStep\n|\n[1]\n|~";
+    }
+
+    string ChoiceScript (u32 choice_s) { /* one range with many choices, a fifth of them conditional */
+        string text = "[[1]]\n#Count++#\nPick one\n|\n{\n";
+        for (u32 i = 0; i < choice_s; i++) {
+            bool isConditional = (i % 5 == 4);
+            text += (isConditional) ? "&Count % 2 == 0&" : "";
+            text += "{Choice " + std::to_string(i) + "}\n    #picked = " + std::to_string(i) + "#\n    Picked " + std::to_string(i) + "\n";
+            text += (isConditional) ? "||\n" : "";
+        }
+        return text + "}\n|\n[1]\n|~";
+    }
+
+    string VariableScript (u32 var_s) { /* thousands of globals and locals written every step, all of them go into the save data */
+        string text = "[[1]]\n#Count++#\n";
+        for (u32 i = 0; i < var_s; i++) {
+            if (i % 2 == 0) { text += "#V" + std::to_string(i) + " += " + std::to_string(i % 13) + "#\n"; }
+            else            { text += "#v" + std::to_string(i) + " = V" + std::to_string(i - 1) + " % 7#\n"; }
+        }
+        return text + "Step\n|\n[1]\n|~";
+    }
+
+    string Prose (u32 word_s) {
+        const char* words[] = {"the", "lantern", "flickered", "as", "Mira", "crossed", "an", "old", "stone", "bridge", "over-the-river", "whispering", "quietly", "to", "herself,"};
+        string text = "";
+        for (u32 i = 0; i < word_s; i++) {
+            text += words[(i * 7 + i / 3) % 15];
+            text += (i % 17 == 16) ? "\n    " : " ";
+        }
+        return text;
+    }
+
+    string ProseScript (u32 word_s) { /* a long paragraph shown every step */
+        return "[[1]]\n#Count++#\n" + Prose(word_s) + "\n|\n[1]\n|~";
+    }
+
+    string SessionScript () { /* a choice, a conditional and a few variables every step, like a played session */
+        return "[[1]]\n#Count++#\n&Count % 3 == 0& #gold += 5# ||\nShall we?\n|\n{\n{Yes} #Answers++# Fine.\n{No} #refusals += 1# Pity.\n}\n|\n[1]\n|~";
+    }
+
+    void Step (dial::State* state, u32 step_i) { /* continues or picks a valid choice, the step number spreads the picks */
+        if (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_CONTINUATION)) {
+            dial::Continuation(state);
+        }
+        elif (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_CHOICE)) {
+            u32 choices_s = dial::GetChoicesSize(state);
+            for (u32 i = 0; i < choices_s; i++) {
+                if (dial::IsChoiceValid(state, (step_i + i) % choices_s)) {
+                    dial::Choice(state, (step_i + i) % choices_s);
+                    break;
+                }
+            }
+        }
+        dial::Dialogue_T(state);
+        if (dial::IsCurrentStatus(state, dial::Status::FINISHED) || dial::IsCurrentStatus(state, dial::Status::INTERPRET)) {
+            std::cerr<<"A generated script stopped\n";
+            exit(1);
+        }
+    }
+
+    void LoadBenchmarks (Suite* suite, const vector<std::pair<string,string>>& scripts) {
+        for (auto& script : scripts) {
+            Measure(suite, "State_I/" + script.first, 1, "items", [&](unsigned long long n) {
+                for (unsigned long long i = 0; i < n; i++) {
+                    dial::State* state = dial::State_I(script.first);
+                    dial::State_D(state);
+                    dial::ChapterCacheClear();
+                }
+            });
+        }
+    }
+
+    void StepBenchmarks (Suite* suite, const vector<std::pair<string,string>>& scripts) {
+        for (auto& script : scripts) {
+            dial::Engine* engine = dial::Engine_I(); /* the variables of one script don't slow down the diffs of the next */
+            dial::State* state = dial::State_I(script.first, engine);
+            dial::Dialogue_T(state);
+            u32 step_i = 0;
+            Measure(suite, "Dialogue_T/" + script.first, 1, "items", [&](unsigned long long n) {
+                for (unsigned long long i = 0; i < n; i++) {
+                    Step(state, step_i++);
+                }
+            });
+            dial::State_D(state);
+            dial::Engine_D(engine);
+        }
+    }
+
+    void OperationBenchmarks (Suite* suite) {
+        dial::State* state = dial::State_I("bench_session");
+        dial::VarInstrInterpret(state, "Count = 4");
+        dial::VarInstrInterpret(state, "name = \"dia4ogu\"");
+        dial::VarInstrInterpret(state, "hits = 3");
+        vector<std::pair<string,string>> expressions = {
+            {"arithmetic", "(Count * 3 + 7) % 11 - MIN(Count, 5) ^ 2 + MAX(hits, 2) / 2"},
+            {"strings",    "\"dia\" + STR(Count) + SUBSTR(\"logue\", 1, 2) == name"},
+            {"logic",      "Count > 2 AND (hits < 5 OR !(Count == 4)) AND LEN(name) != 0"},
+            {"literals",   "(10 / 2) == (55 % 10 + 10 - 5 * 2)"}
+        };
+        for (auto& expression : expressions) {
+            vector<string> segments = dial::SplitInstrSegments(expression.second);
+            Measure(suite, "OperationsInterpret/" + expression.first, 1, "items", [&](unsigned long long n) {
+                for (unsigned long long i = 0; i < n; i++) {
+                    dial::ArenaReset(dial::ThreadArena()); /* as at the beginning of every pass */
+                    dial::OperationsInterpret(state, segments);
+                }
+            });
+        }
+        dial::State_D(state);
+    }
+
+    void SaveBenchmarks (Suite* suite) { /* loading replays the session, so the round trip grows with it */
+        for (u32 step_s : {10u, 100u, 1000u}) {
+            dial::State* state = dial::State_I("bench_session");
+            dial::Dialogue_T(state);
+            for (u32 i = 0; i < step_s; i++) {
+                Step(state, i);
+            }
+            Measure(suite, "StateSaveLoad/steps:" + std::to_string(step_s), 1, "items", [&](unsigned long long n) {
+                for (unsigned long long i = 0; i < n; i++) {
+                    dial::StateSave(state, 0);
+                    dial::State* loadedState = dial::StateLoad("bench_session", 0);
+                    dial::State_D(loadedState);
+                }
+            });
+            dial::State_D(state);
+        }
+        remove("save_bench_session_0.txt");
+    }
+
+    void WrapBenchmarks (Suite* suite) {
+        string text = dial::RemoveWhitespace(Prose(20000));
+        for (u32 width : {40u, 120u}) {
+            Measure(suite, "WrapText/width:" + std::to_string(width), text.length(), "bytes", [&](unsigned long long n) {
+                for (unsigned long long i = 0; i < n; i++) {
+                    string wrapped = dial::WrapText(text, width);
+                    if (wrapped.length() < text.length()) { exit(1); } /* uses the result, so it isn't optimized away */
+                }
+            });
+        }
+    }
+
+    string JsonEscape (const string& text) {
+        string escaped = "";
+        for (char symbol : text) {
+            if (symbol == '"' || symbol == '\\') { escaped += '\\'; }
+            escaped += symbol;
+        }
+        return escaped;
+    }
+
+    bool JsonWrite (Suite* suite, const string& file_n, const string& executable) {
+        FILE* file = fopen(file_n.c_str(), "wb");
+        if (file == nullptr) { return false; }
+
+        std::time_t now = std::time(nullptr);
+        char date[32];
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+        #ifdef DIAL_PROFILE
+        const char* buildType = "profile";
+        #else
+        const char* buildType = "release";
+        #endif
+        fprintf(file, "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"executable\": \"%s\",\n    \"num_cpus\": %u,\n    \"library_build_type\": \"%s\"\n  },\n  \"benchmarks\": [\n",
+                date, JsonEscape(executable).c_str(), std::thread::hardware_concurrency(), buildType);
+        for (u32 i = 0; i < suite->results.size(); i++) {
+            const Result& result = suite->results[i];
+            double rate = result.item_c * 1e9 / std::max(result.realTime_ns, 1e-9);
+            fprintf(file, "    {\n      \"name\": \"%s\",\n      \"run_name\": \"%s\",\n      \"run_type\": \"iteration\",\n      \"iterations\": %llu,\n"
+                          "      \"real_time\": %.3f,\n      \"cpu_time\": %.3f,\n      \"time_unit\": \"ns\",\n      \"%s_per_second\": %.3f,\n      \"heap_allocations\": %.3f\n    }%s\n",
+                    JsonEscape(result.name).c_str(), JsonEscape(result.name).c_str(), result.iteration_c, result.realTime_ns, result.cpuTime_ns,
+                    result.itemUnit.c_str(), rate, result.heapAllocation_c, (i + 1 == suite->results.size()) ? "" : ",");
+        }
+        fputs("  ]\n}\n", file);
+        fclose(file);
+        return true;
+    }
+}
+
+int main (int argc, char** argv) {
+    bench::Suite suite = {"", 0.5, {}, {}};
+    string json_n = "";
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--filter=", 0) == 0)        { suite.filter = arg.substr(9); }
+        elif (arg.rfind("--min-time=", 0) == 0)    { suite.minTime = std::stod(arg.substr(11)); }
+        elif (arg.rfind("--json=", 0) == 0)        { json_n = arg.substr(7); }
+        else {
+            std::cerr<<"usage: "<<argv[0]<<" [--filter=text] [--min-time=seconds] [--json=file]\n";
+            return 1;
+        }
+    }
+
+    vector<std::pair<string,string>> scripts = {
+        {"bench_conditionals", bench::ConditionalScript(200)},
+        {"bench_nesting",      bench::NestingScript(64)},
+        {"bench_choices",      bench::ChoiceScript(500)},
+        {"bench_variables",    bench::VariableScript(2000)},
+        {"bench_prose",        bench::ProseScript(3000)},
+        {"bench_session",      bench::SessionScript()}
+    };
+    for (auto& script : scripts) {
+        bench::FileWrite(&suite, script.first + ".dial", script.second);
+    }
+
+    std::cout<<std::left<<std::setw(44)<<"benchmark"<<std::right<<std::setw(17)<<"time"<<std::setw(17)<<"cpu"<<std::setw(12)<<"iterations"
+             <<std::setw(18)<<"rate"<<std::setw(12)<<"allocs"<<"\n";
+    #ifdef DIAL_PROFILE
+    prof::Reset();
+    #endif
+    bench::LoadBenchmarks(&suite, scripts);
+    bench::StepBenchmarks(&suite, scripts);
+    bench::OperationBenchmarks(&suite);
+    bench::SaveBenchmarks(&suite);
+    bench::WrapBenchmarks(&suite);
+    #ifdef DIAL_PROFILE
+    std::cout<<std::flush;
+    prof::SummaryPrint();
+    prof::TraceWrite("bench_trace.json");
+    #endif
+
+    for (auto& file_n : suite.files) {
+        remove(file_n.c_str());
+    }
+    if (json_n != "" && !bench::JsonWrite(&suite, json_n, argv[0])) {
+        std::cerr<<"Could not write "<<json_n<<"\n";
+        return 1;
+    }
+    return 0;
+}
+
+#undef u32
+#undef elif
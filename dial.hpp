@@ -1,5 +1,54 @@
 #ifndef DIAL_HPP
 #define DIAL_HPP
+/* the interpreter needs only the standard library and the OS's file calls, no window or GL; test.cpp and the tools build it headless */
+
+#include <stdlib.h>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <cmath>
+#include <climits>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <queue>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <iterator>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <memory_resource>
+#include <thread>
+#include <chrono>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#else
+#include <filesystem>
+#endif
+
+#ifdef DIAL_PROFILE /* times the interpreter's stages into prof.hpp's rings; without it the macros cost nothing */
+#include "prof.hpp"
+#define DIAL_PROF_SCOPE(name)        prof::Scope profScope(name)
+#define DIAL_PROF_COUNT(name, value) prof::Count(name, value)
+#else
+#define DIAL_PROF_SCOPE(name)
+#define DIAL_PROF_COUNT(name, value)
+#endif
 
 #define u32 unsigned int
 #define elif else if
@@ -13,6 +62,9 @@ namespace dial {
     /* Constants */
     const u32 DIAL_DEFAULT_TEXT_WIDTH = 40;
     const u32 DIAL_JUMP_LOOP_LIMIT = 100;
+    const u32 DIAL_CHAPTER_CACHE_SIZE = 4; /* chapters kept loaded after no state plays them */
+    const char* const DIAL_BASES_MANIFEST = "dial.bases"; /* kept in the directory of the @INCLUDE@d files with their jump bases, so that loading a script doesn't read its chapters */
+    const u32 DIAL_ARENA_SIZE = 64 * 1024; /* bytes of temporaries the passes on one thread can use before the thread's arena falls back to the heap */
 
     enum class TextType {
         NONE,
@@ -27,6 +79,7 @@ namespace dial {
         string actor_n;
         string text;
         TextType type;
+        u32 revealSpeed; /* glyphs per second of the typewriter reveal, 0 shows the whole text at once */
     };
 
     struct Pos {
@@ -34,70 +87,373 @@ namespace dial {
         int condNestingDepth;
     };
 
+    struct Jump { /* an entry of the jump history, [~] returns to its position */
+        int base_i;
+        Pos pos;
+        string file_n;
+    };
+
     struct ChoiceObject {
-        string instrText;
+        u32 text_i; /* index of the choice's '{' in the script's text */
         string displayText;
         TextType type;
         map<string,string> accentedOptions;
         Pos jumpPos;
+        int counter_i; /* index of its hasOneUseChoiceRecurred flag, -1 if it has none */
     };
 
     enum class Status {
         NONE,
         WAIT_FOR_CONTINUATION,
         WAIT_FOR_CHOICE,
+        WAIT_FOR_TIME,
         INTERPRET,
         FATAL_ERROR,
         FINISHED
     };
 
     enum class Flags {
-        AUTO_LOAD = 1
+        AUTO_LOAD = 1,
+        NO_BACKTRACK = 2 /* the DIAL_DEBUG build takes no snapshots of the state */
     };
 
-    struct State {
-        char* text;
+    template <typename T>
+    struct Cow { /* copy-on-write: copies share the value until one of them writes to it, so copying states and snapshots is O(1) */
+        struct Shared {
+            T value;
+            std::atomic<u32> ref_c;
+        };
+        Shared* shared;
+
+        Cow () : shared(new Shared{T(), 1}) {}
+        Cow (const Cow& other) : shared(other.shared) { shared->ref_c.fetch_add(1, std::memory_order_relaxed); }
+        Cow& operator= (const Cow& other) {
+            if (shared != other.shared) {
+                other.shared->ref_c.fetch_add(1, std::memory_order_relaxed);
+                Release();
+                shared = other.shared;
+            }
+            return *this;
+        }
+        ~Cow () { Release(); }
+
+        void Release () { /* the release half orders this owner's reads before another thread's in-place write */
+            if (shared->ref_c.fetch_sub(1, std::memory_order_acq_rel) == 1) { delete shared; }
+        }
+        const T& operator* () const { return shared->value; }
+        const T* operator-> () const { return &shared->value; }
+        T& Write () { /* the value may be shared with a state on another thread, the acquire load sees that thread's release of it */
+            if (shared->ref_c.load(std::memory_order_acquire) != 1) {
+                Shared* copy = new Shared{shared->value, 1};
+                Release();
+                shared = copy;
+            }
+            return shared->value;
+        }
+    };
+
+    template <typename T, u32 CHUNK_S = 64>
+    struct Chunked { /* a vector that only changes at its end, kept in Cow chunks: a write after a snapshot copies the chunk list and one chunk, the full ones stay shared */
+        Cow<vector<Cow<vector<T>>>> chunks; /* the ones past the end are empty and keep their capacity */
+        u32 size_c = 0;
+
+        struct const_iterator {
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+            const Chunked* owner;
+            u32 i;
+
+            const T& operator* () const { return (*owner)[i]; }
+            const T* operator-> () const { return &(*owner)[i]; }
+            const_iterator& operator++ () { i++; return *this; }
+            const_iterator& operator-- () { i--; return *this; }
+            const_iterator operator++ (int) { const_iterator it = *this; i++; return it; }
+            const_iterator operator-- (int) { const_iterator it = *this; i--; return it; }
+            bool operator== (const const_iterator& other) const { return i == other.i; }
+            bool operator!= (const const_iterator& other) const { return i != other.i; }
+        };
+
+        const Chunked& operator* () const { return *this; } /* read like a Cow */
+        const Chunked* operator-> () const { return this; }
+        u32 size () const { return size_c; }
+        bool empty () const { return size_c == 0; }
+        const T& operator[] (u32 i) const { return (*(*chunks)[i / CHUNK_S])[i % CHUNK_S]; }
+        const T& back () const { return (*this)[size_c - 1]; }
+        const_iterator begin () const { return {this, 0}; }
+        const_iterator end () const { return {this, size_c}; }
+        std::reverse_iterator<const_iterator> rbegin () const { return std::reverse_iterator<const_iterator>(end()); }
+        std::reverse_iterator<const_iterator> rend () const { return std::reverse_iterator<const_iterator>(begin()); }
+
+        T& Write (u32 i) { return chunks.Write()[i / CHUNK_S].Write()[i % CHUNK_S]; }
+        void push_back (T&& value) {
+            vector<Cow<vector<T>>>& list = chunks.Write();
+            if (size_c / CHUNK_S == list.size()) {
+                list.emplace_back();
+                list.back().Write().reserve(CHUNK_S);
+            }
+            list[size_c / CHUNK_S].Write().push_back(std::move(value));
+            size_c++;
+        }
+        void push_back (const T& value) { push_back(T(value)); }
+        void pop_back () {
+            size_c--;
+            chunks.Write()[size_c / CHUNK_S].Write().pop_back();
+        }
+        void reserve (u32 capacity) { /* adds the empty chunks, so filling them doesn't allocate the chunks */
+            vector<Cow<vector<T>>>& list = chunks.Write();
+            list.reserve((capacity + CHUNK_S - 1) / CHUNK_S);
+            while (list.size() * CHUNK_S < capacity) {
+                list.emplace_back();
+                list.back().Write().reserve(CHUNK_S);
+            }
+        }
+    };
+
+    struct ArenaUpstream : std::pmr::memory_resource { /* the heap behind an arena, it counts how often the arena's buffer ran out */
+        u32 overflow_c = 0;
+
+        void* do_allocate (size_t bytes, size_t alignment) override {
+            overflow_c++;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        void do_deallocate (void* p, size_t bytes, size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal (const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    struct Arena { /* bump allocator for the temporaries of one Dialogue_T pass, released at its beginning */
+        char* buffer;
+        u32 buffer_s;
+        ArenaUpstream upstream;
+        u32 resetOverflow_c; /* upstream.overflow_c at the last reset */
+        u32 pass_c;          /* Dialogue_T passes running on the arena's thread */
+        std::pmr::monotonic_buffer_resource* resource;
+    };
+
+    struct Engine { /* owns what used to be process-wide; states sharing an engine share the global variables */
+        Cow<map<string, std::pair<int,string>>> vars; /* global variables */
+        bool isBacktrackLocked;
+    };
+
+    enum Operator { /* operator, its assigned number is the precedence */
+        OP_NONE,
+        OP_OR,OP_AND,
+        OP_EQ,OP_NEQ,OP_GT,OP_GE,OP_LT,OP_LE, /* for condInterpreter */
+        OP_ADD,OP_SUB,OP_MUL,OP_DIV,OP_MOD,OP_POW,  /* for both */
+        OP_NOT,OP_LEN,OP_STR,OP_MIN,OP_MAX,OP_SUBSTR,
+        OP_COMMA,OP_LP,OP_NLP,OP_RP,
+        OP_IS,OP_EADD,OP_ESUB,OP_EMUL,OP_EDIV,OP_EMOD,OP_EPOW  /* for varInterpreter */
+    };
+
+    struct Value { /* an operand of the evaluator; the text points into a segment, a variable or the state's arena */
+        std::string_view text;
+        int number;
+        bool isString; /* makes + concatenate and ==, != compare the texts; a variable holding "" is still the number */
+    };
+
+    struct Token { /* a segment classified before the evaluation; it refers to its segment by the index, so compiled instructions can be copied */
+        Operator op;
+        u32 segment_i;
+        int number;      /* of a number literal or of a folded constant */
+        bool isText;     /* a quoted literal, its text is the segment without the quotes */
+        bool isString;   /* the literal is a string one, "" included */
+        bool isVariable;
+    };
+
+    struct Instr { /* an instruction compiled when the script is loaded */
+        u32 end_i;              /* position right after its closing symbol */
+        string instrText;       /* the text as ScanTextUntil would return it */
+        vector<string> segments;
+        int counter_i;          /* index of a conditional's condRepeat_c counter, -1 for the other instructions */
+        std::pmr::vector<Token> tokens; /* the expression in postfix, a conditional's with the constant parts folded; empty if it has to be built at runtime */
+        int staticResult;       /* 1 or 0 when a conditional doesn't depend on the state, -1 otherwise */
+        u32 skip_i;             /* where a false conditional continues, right after its '||'; 0 if it is sought at runtime */
+        bool isFolded;
+    };
+
+    struct LinkedFile { /* an @INCLUDE@d file's jump base numbers, valid while the file keeps its modification time and size */
+        long long modified;
+        long long size;
+        vector<u32> bases;
+    };
+
+    struct Script { /* a loaded .dial file with its index; it isn't modified after loading and is shared by every state playing it */
+        string file_n;
+        const char* text; /* read-only, the comments stay in it */
         u32 text_s;
+        vector<std::pair<u32,u32>> comments; /* start and end of every comment, sorted; the scanners skip them */
+        map<u32, Pos> jumpBasePos;
+        map<u32, Instr> instrs; /* compiled '#', '@', '&', '$' and '[' instructions by the position of their opening symbol */
+        map<u32, string> linkedBases; /* jump bases of the @INCLUDE@d files by their number, indexed without loading those files */
+        map<u32, int> choiceCounters; /* position after a choice's '}' -> index of its one-use flag */
+        vector<u32> lineStarts; /* position where each line begins, the first is 0; positions are turned into lines by a binary search */
+        u32 counterBase; /* the script's conditionals and choices own the counter indices from counterBase to counterBase + counter_s */
+        u32 counter_s;
+        std::atomic<int> ref_c;
+        void* mapping;     /* start of the file mapping, nullptr when the text was read into memory instead */
+        size_t mapping_s;
+        void* fileHandle;  /* Windows handles of the mapping */
+        void* mappingHandle;
+        std::atomic<Script*> newer; /* the reloaded version of the file, which this script holds a reference to */
+    };
+
+    struct Watcher { /* reloads the changed scripts of a directory on its own thread */
+        string directory;
+        std::thread thread;
+        std::atomic<bool> isRunning;
+    };
+
+    struct Snapshot { /* a state waiting at one shown text or choice range; the containers stay shared with the state until either writes */
+        Cow<map<string, std::pair<int,string>>> vars;
+        Cow<map<string, std::pair<int,string>>> localVars;
+        Chunked<TextObject> textObjs;
+        Chunked<Jump> jumpHistory;
+        Cow<vector<bool>> hasOneUseChoiceRecurred;
+        Cow<vector<int>> condRepeat_c;
+        Cow<map<string, std::pair<int,string>>> globalVarsCopy;
+        string file_n;
+        Pos currentPos;
+        Status status;
+        string actor_n;
+        u32 textSpeed;
+        vector<std::pair<string,string>> persCond;
+        vector<bool> condElse;
+        u32 randomState[4];
+        u32 randomDraw_c;
+        vector<ChoiceObject> choices;
+        set<string> possibleAccents;
+        string currentAccent;
+        u32 saveData_s; /* the save data only grows, so it is cut back to this size */
+    };
+
+    enum class SinkEvent { /* what changed in the state's textObjs, which always hold the whole picture */
+        TEXT_SHOWN,     /* the last text object was added */
+        CHOICES_SHOWN,  /* the last choices.size() text objects were added */
+        ACCENT_CHANGED, /* the last choices.size() text objects were rewritten */
+        TEXTS_REPLACED, /* any of them may have changed, e.g. after a choice */
+        FINISHED
+    };
+
+    struct State;
+    struct Sink { /* receives what the interpreter shows; it is called on the interpreting thread and never for speculative forks */
+        void (*onEvent)(State* state, SinkEvent event, void* user); /* nullptr for no output */
+        void* user;
+    };
+
+    struct RenderChanges { /* filled by RendererSink, the renderer rebuilds the text objects from firstChanged_i and clears it */
+        bool isChanged;
+        u32 firstChanged_i;
+        bool isFinished;
+    };
+
+    struct State {
+        Engine* engine;
+        Script* script;
         u32 textWidth;
+        u32 textSpeed;
         string displayText;
         string actor_n;
-        vector<TextObject> textObjs;
+        Chunked<TextObject> textObjs;
         Status status;
         Flags flags;
         Pos currentPos;
-        map<u32, Pos> jumpBasePos;
-        vector<std::pair<int,Pos>> jumpHistory;
+        Chunked<Jump> jumpHistory;
         vector<std::pair<string,string>> persCond;
         vector<bool> condElse;
-        map<string,std::pair<int,string>> localVars;
+        Cow<map<string,std::pair<int,string>>> localVars;
         vector<ChoiceObject> choices;
         set<string>::iterator currentAccent;
         set<string> possibleAccents;
-        map<u32, bool> hasOneUseChoiceRecurred;
-        map<u32, int> condRepeat_c; 
+        Cow<vector<bool>> hasOneUseChoiceRecurred;
+        Cow<vector<int>> condRepeat_c;
+        int condCounter_i; /* counter of the conditional being evaluated, read by REPEAT and ONCE */
         u32 seedRandom;
-        map<string, std::pair<int,string>> globalVarsCopy;
+        u32 randomState[4]; /* xoshiro128** generator behind the RANDOM variable, seeded from seedRandom */
+        vector<int> randomTape; /* values RANDOM takes before the generator is used; lets tools drive RANDOM as a branching point */
+        u32 randomDraw_c;
+        double waitTime; /* seconds left until the WAIT_FOR_TIME status ends */
+        Cow<map<string, std::pair<int,string>>> globalVarsCopy;
         vector<string> saveData;
+        bool isSpeculative; /* a prefetched fork, its sink isn't called */
+        Sink sink;
+        Cow<vector<Snapshot>> backtrack; /* one snapshot per displayed step, filled in DIAL_DEBUG builds */
+        vector<string> segments_b; /* the strings of the last instruction split while interpreting, reused by the next one */
+        vector<ChoiceObject> choices_b; /* the choice objects of the earlier choice ranges, reused with their strings' capacity */
+        vector<TextObject> textObjs_b; /* the shown choices removed by the last choice, reused by the next ones */
     };
 
+    struct Prefetch { /* the next step of a waiting state, computed ahead on a worker thread for every choice */
+        State* source;
+        Script* sourceScript;   /* what the forks were made from, a changed state can't adopt them */
+        Pos sourcePos;
+        u32 sourceSaveData_s;
+        string sourceAccent;
+        vector<State*> branches; /* one per choice, or a single one for the continuation */
+        vector<Engine*> engines;
+        void (*onBranchReady)(State* branch, void* user); /* runs on the worker thread, e.g. to lay out the glyphs of the new texts */
+        void* user;
+        std::thread thread;
+        std::atomic<bool> isReady;
+    };
 
-    map<string, std::pair<int,string>> Vars; /* global variables */
-
-
-    State* State_I (string file_n);
-    void   State_D (State*& state);
-    void   StateSave (State* state, int save_i);
-    State* StateLoad (string file_n, int save_i);
-    void   LoadJumpBases (State* state);
-
-    void   SeekUntil (char* txt, u32& t_i, string endingChars);
-    void   SeekEndOfConditional (char* txt, u32& t_i);
-    void   SeekEndOfChoiceRange (char* txt, u32& t_i);
-    void   SeekEndOfStatement (char* txt, u32& t_i, string endingChar);
-    string ScanTextUntil (char* txt, u32& t_i, string endingChars);
-    bool   IsItConditionalChoice (char* txt, u32 t_i);
 
+    Engine DefaultEngine = {}; /* used by the states created without an explicit engine */
+    map<string, Script*> Scripts; /* loaded scripts by their file name */
+    std::mutex ScriptsMutex;
+    vector<Script*> ChapterCache; /* most recently played first, each holds a reference */
+    map<string, std::pair<u32,u32>> CounterRanges; /* file name -> first counter index and count, kept so a reloaded file gets its old counters */
+    u32 Counter_s = 0; /* counter indices handed out so far */
+    std::mutex CountersMutex;
+    map<string, map<string, LinkedFile>> BasesManifests; /* manifest path -> file name in its directory -> jump bases; each manifest is read once */
+    std::set<string> BasesManifestsChanged; /* manifests with files that had to be scanned again */
+    std::mutex BasesManifestMutex;
+    bool AreBasesManifestsWritten = false; /* set by a host that lets loading write the manifests; otherwise a load never creates a file */
+    bool AreScriptsMapped = true; /* a file rewritten in place would change under its mapping, so the watcher turns it off */
+    bool AreScriptsLinted = false; /* set by a host whose scripts passed dial-lint, the debug build then skips its checks when loading them */
+
+
+    Arena*  Arena_I (u32 buffer_s = DIAL_ARENA_SIZE);
+    void    Arena_D (Arena*& arena);
+    Arena*  ThreadArena ();
+    Engine* Engine_I ();
+    void    Engine_D (Engine*& engine);
+    void    Script_D (Script*& script);
+    bool    ScriptCompile (Script* script);
+    void    ScriptRelease (Script*& script);
+    Script* ChapterAcquire (string file_n);
+    void    ChapterTouch (Script* script);
+    Watcher* Watcher_I (string directory = ".");
+    void    Watcher_D (Watcher*& watcher);
+    State*  State_I (string file_n, Engine* engine = nullptr);
+    void    State_D (State*& state);
+    void    StateSave (State* state, int save_i);
+    string  StateSaveText (State* state);
+    State*  StateLoad (string file_n, int save_i, Engine* engine = nullptr);
+    State*  StateLoadText (const string& text, string save_n, Engine* engine = nullptr);
+    void   LoadLineStarts (Script* script);
+    void   LoadComments (Script* script);
+    void   LoadJumpBases (Script* script);
+    void   LoadLinkedBases (Script* script);
+    void   AssignCounterRange (Script* script);
+
+    u32    CommentEnd (Script* script, u32 t_i);
+    void   SkipWhitespace (Script* script, u32& t_i);
+    void   SeekUntil (Script* script, u32& t_i, string endingChars);
+    void   SeekEndOfConditional (Script* script, u32& t_i, bool isReported = true);
+    void   SeekEndOfChoiceRange (Script* script, u32& t_i);
+    void   SeekEndOfStatement (Script* script, u32& t_i, string endingChar);
+    string ScanTextUntil (Script* script, u32& t_i, string endingChars);
+    bool   IsItConditionalChoice (Script* script, u32 t_i);
+
+    Sink   NullSink ();
+    Sink   ConsoleSink (FILE* file = stdout);
+    Sink   RendererSink (RenderChanges* changes);
     void   ShowRefreshedText (State* state);
+    Prefetch* Prefetch_I (State* state, void (*onBranchReady)(State* branch, void* user) = nullptr, void* user = nullptr);
     
     void Dialogue_T (State* state);
 
@@ -114,11 +470,89 @@ namespace dial {
         }
     }
 
+    void SeedRandom (State* state, u32 seed) { /* seeds the state's own generator (splitmix32), so that no global rand() stream is shared */
+        state->seedRandom = seed;
+        for (u32 i = 0; i < 4; i++) {
+            seed += 0x9E3779B9;
+            u32 z = seed;
+            z = (z ^ (z >> 16)) * 0x85EBCA6B;
+            z = (z ^ (z >> 13)) * 0xC2B2AE35;
+            state->randomState[i] = z ^ (z >> 16);
+        }
+    }
+
+    u32 NextRandom (State* state) { /* xoshiro128** */
+        u32* r = state->randomState;
+        u32 result = r[1] * 5; result = ((result << 7) | (result >> 25)) * 9;
+        u32 t = r[1] << 9;
+        r[2] ^= r[0]; r[3] ^= r[1]; r[1] ^= r[2]; r[0] ^= r[3];
+        r[2] ^= t;
+        r[3] = (r[3] << 11) | (r[3] >> 21);
+        return result;
+    }
+
 // ERROR-HANDLING FUNCTIONS
 
-    string GetCurrentTextFilePos (char* txt, u32 target_i) {
+    void LoadLineStarts (Script* script) { /* the lines inside the comments are counted too */
+        const char* txt = script->text;
+        const char* end = txt + script->text_s;
+        script->lineStarts.clear();
+        script->lineStarts.push_back(0);
+        for (const char* c = txt; (c = (const char*)memchr(c, '\n', end - c)) != nullptr; c++) {
+            script->lineStarts.push_back((u32)(c - txt) + 1);
+        }
+    }
+
+    void LoadComments (Script* script) { /* the text is read-only, so the comments are indexed instead of blanked out */
+        const char* txt = script->text;
+        vector<std::pair<u32,u32>>& comments = script->comments;
+        comments.clear();
+        auto Comment = [&](u32 i) { /* adjacent commented characters make up one span */
+            if (!comments.empty() && comments.back().second > i) { return; }
+            if (!comments.empty() && comments.back().second == i) { comments.back().second = i + 1; }
+            else { comments.push_back(std::make_pair(i, i + 1)); }
+        };
+        auto At = [&](u32 i) { /* a commented character doesn't start another symbol */
+            return (!comments.empty() && comments.back().second > i) ? '\t' : txt[i];
+        };
+        bool isComment = false;
+        bool isInsideDoubleSlashComment = false;
+        u32 commentNestingDepth = 0;
+        for (u32 i = 0; i < script->text_s; i++) { /* @TODO check the logic here thoroughly */
+            if (At(i) == '/' && At(i + 1) == '*') {
+                isComment = true;
+                commentNestingDepth++;
+                Comment(i); Comment(i + 1);
+            }
+            if (At(i) == '*' && At(i + 1) == '/') {
+                commentNestingDepth--;
+                if (commentNestingDepth == 0 && !isInsideDoubleSlashComment) {
+                    isComment = false;
+                }
+                Comment(i); Comment(i + 1);
+            }
+            if (At(i) == '/' && At(i + 1) == '/') {
+                isInsideDoubleSlashComment = !isInsideDoubleSlashComment; 
+                if (commentNestingDepth == 0 && !isInsideDoubleSlashComment) {
+                    isComment = false;
+                }
+                Comment(i); Comment(i + 1);
+                i++;
+            }
+            if (isComment) {
+                Comment(i);
+            }
+        }
+    }
+
+    u32 GetLineIndex (Script* script, u32 target_i) { /* 0 for the first line */
+        auto it = std::upper_bound(script->lineStarts.begin(), script->lineStarts.end(), target_i);
+        return (u32)(it - script->lineStarts.begin()) - 1;
+    }
+
+    string GetCurrentTextFilePos (const char* txt, u32 target_i) { /* for texts without a line table, it counts the lines from the beginning */
         int line_c = 1; /* current line */
-        int col_c = 0;  /* current column */
+        int col_c = 1;  /* current column */
         for (u32 i = 0; i != target_i; i++) {
             if (txt[i] == '\n') {
                 line_c++;
@@ -129,9 +563,15 @@ namespace dial {
         return "(Line:" + std::to_string(line_c) + ", Col:" + std::to_string(col_c) + ")";
     }
 
-    void Error (string errText, char* txt, u32 t_i) {
+    string GetCurrentTextFilePos (Script* script, u32 target_i) {
+        if (script->lineStarts.empty()) { return GetCurrentTextFilePos(script->text, target_i); }
+        u32 line_i = GetLineIndex(script, target_i);
+        return "(Line:" + std::to_string(line_i + 1) + ", Col:" + std::to_string(target_i - script->lineStarts[line_i] + 1) + ")";
+    }
+
+    void Error (string errText, Script* script, u32 t_i) {
         #ifdef DIAL_DEBUG
-        std::cerr<<"\n:ERROR: "<<GetCurrentTextFilePos(txt, t_i)<<" "<<errText<<"\n\n";
+        std::cerr<<"\n:ERROR: "<<GetCurrentTextFilePos(script, t_i)<<" "<<errText<<"\n\n";
         #endif
     }
 
@@ -141,22 +581,86 @@ namespace dial {
         #endif
     }
 
+    void Warning (string warnText, Script* script, u32 t_i) {
+        #ifdef DIAL_DEBUG
+        std::cerr<<"\n:WARNING: "<<GetCurrentTextFilePos(script, t_i)<<" "<<warnText<<"\n\n";
+        #endif
+    }
+
     #ifdef DIAL_DEBUG
-    bool isBacktrackLocked = false;
-    void SaveBacktrackState (State* state) {
+    void SaveBacktrackState (State* state) { /* the snapshot shares the containers with the state, only the small per-step fields are copied */
         if (state == nullptr) { return; }
+
+        Snapshot snapshot;
+        snapshot.vars = state->engine->vars;
+        snapshot.localVars = state->localVars;
+        snapshot.textObjs = state->textObjs;
+        snapshot.jumpHistory = state->jumpHistory;
+        snapshot.hasOneUseChoiceRecurred = state->hasOneUseChoiceRecurred;
+        snapshot.condRepeat_c = state->condRepeat_c;
+        snapshot.globalVarsCopy = state->globalVarsCopy;
+        snapshot.file_n = state->script->file_n;
+        snapshot.currentPos = state->currentPos;
+        snapshot.status = state->status;
+        snapshot.actor_n = state->actor_n;
+        snapshot.textSpeed = state->textSpeed;
+        snapshot.persCond = state->persCond;
+        snapshot.condElse = state->condElse;
+        std::copy(state->randomState, state->randomState + 4, snapshot.randomState);
+        snapshot.randomDraw_c = state->randomDraw_c;
+        snapshot.choices = state->choices;
+        snapshot.possibleAccents = state->possibleAccents;
+        snapshot.currentAccent = (state->possibleAccents.size() != 0) ? *(state->currentAccent) : "";
+        snapshot.saveData_s = state->saveData.size();
+        state->backtrack.Write().push_back(snapshot);
     }
 
-    void LoadBacktrackState (State* state) {
-        if (state == nullptr) { return; }
+    void LoadBacktrackState (State* state, u32 step_c = 1) { /* goes back the given number of shown texts or choice ranges */
+        if (state == nullptr || state->backtrack->size() < 2) { return; }
+
+        vector<Snapshot>& backtrack = state->backtrack.Write();
+        u32 pop_c = std::min((u32)backtrack.size() - 1, step_c); /* the top snapshot is what is shown now */
+        backtrack.resize(backtrack.size() - pop_c);
+        const Snapshot& snapshot = backtrack.back();
+
+        if (snapshot.file_n != state->script->file_n) {
+            Script* chapter = ChapterAcquire(snapshot.file_n);
+            if (chapter == nullptr) { return; }
+            ChapterTouch(state->script);
+            ScriptRelease(state->script);
+            state->script = chapter;
+        }
+        state->engine->vars = snapshot.vars;
+        state->localVars = snapshot.localVars;
+        state->textObjs = snapshot.textObjs;
+        state->jumpHistory = snapshot.jumpHistory;
+        state->hasOneUseChoiceRecurred = snapshot.hasOneUseChoiceRecurred;
+        state->condRepeat_c = snapshot.condRepeat_c;
+        state->globalVarsCopy = snapshot.globalVarsCopy;
+        state->currentPos = snapshot.currentPos;
+        state->status = snapshot.status;
+        state->actor_n = snapshot.actor_n;
+        state->textSpeed = snapshot.textSpeed;
+        state->persCond = snapshot.persCond;
+        state->condElse = snapshot.condElse;
+        std::copy(snapshot.randomState, snapshot.randomState + 4, state->randomState);
+        state->randomDraw_c = snapshot.randomDraw_c;
+        state->choices = snapshot.choices;
+        state->possibleAccents = snapshot.possibleAccents;
+        state->currentAccent = state->possibleAccents.find(snapshot.currentAccent);
+        if (state->currentAccent == state->possibleAccents.end()) { state->currentAccent = state->possibleAccents.begin(); }
+        state->saveData.resize(snapshot.saveData_s);
+        state->displayText = "";
+        state->waitTime = 0;
+        state->engine->isBacktrackLocked = true; /* the restored screen keeps its snapshot */
     }
     #endif
 
-    bool HasDetectedCriticalErrors (State* state) {
-        if (state == nullptr) { return false; }
+    bool HasDetectedCriticalErrors (Script* script) {
+        if (script == nullptr) { return false; }
 
-        char* txt = state->text;
-        u32& t_i = state->currentPos.text_i;
+        const char* txt = script->text;
+        u32 t_i = 0;
         bool result = false;
 
         struct SpecChar {
@@ -167,7 +671,9 @@ namespace dial {
         };
 
         map<char, SpecChar> chars;
-        while (t_i != state->text_s) {
+        while (true) {
+            t_i = CommentEnd(script, t_i);
+            if (t_i >= script->text_s) { break; }
             switch (txt[t_i]) {
                 case '#': { /* @&{}| */
                     chars['#'].isStatementOpened = !chars['#'].isStatementOpened;
@@ -221,7 +727,6 @@ namespace dial {
             t_i++;
         }
         EndOfCounting:
-        t_i = 0;
 
         /* @TODO positions in detected errors, where possible */
         if (chars['~'].count == 0)                     { Error("The text doesn't have the file ending symbol '|~'."); result = true; }
@@ -241,7 +746,7 @@ namespace dial {
     void ShowVars (State* state) { /* shows all used variables */
         std::cout<<"\n-------LOCAL--------+\n";
         if (state != nullptr) {
-            for (map<string, std::pair<int,string>>::iterator it = state->localVars.begin(); it != state->localVars.end(); it++) {
+            for (auto it = state->localVars->begin(); it != state->localVars->end(); it++) {
                 if ((it->second).second == "") {
                     std::cout<<std::setw(18)<<it->first<<" = "<<(it->second).first<<'\n';
                 }
@@ -251,7 +756,8 @@ namespace dial {
             }
         }
         std::cout<<"\n-------GLOBAL-------+\n";
-        for (map<string, std::pair<int,string>>::iterator it = Vars.begin(); it != Vars.end(); it++) {
+        const map<string, std::pair<int,string>>& Vars = (state != nullptr) ? *(state->engine->vars) : *(DefaultEngine.vars);
+        for (auto it = Vars.begin(); it != Vars.end(); it++) {
             if ((it->second).second == "") {
                 std::cout<<std::setw(18)<<it->first<<" = "<<(it->second).first<<'\n';
             }
@@ -263,19 +769,21 @@ namespace dial {
     }
     
     void SaveVarDiff (State* state) {
+        DIAL_PROF_SCOPE("SaveVarDiff");
         if (state == nullptr) { Error("Couldn't save a difference of variables at the state was deleted."); return; }
-        map<string, std::pair<int,string>> diffVars;
-        for (auto& pair : state->globalVarsCopy) {
+        const map<string, std::pair<int,string>>& Vars = *(state->engine->vars);
+        std::pmr::map<string, std::pair<int,string>> diffVars(ThreadArena()->resource);
+        for (auto& pair : *(state->globalVarsCopy)) {
             if (!Vars.count(pair.first)) {
                 diffVars[pair.first] = pair.second;
             }
         }
         for (auto& pair : Vars) {
-            if (!(state->globalVarsCopy).count(pair.first)){
+            if (!state->globalVarsCopy->count(pair.first)){
                 diffVars[pair.first] = pair.second;
             }
         }
-        for (auto& pair : state->globalVarsCopy) {
+        for (auto& pair : *(state->globalVarsCopy)) {
             auto it = Vars.find(pair.first);
             if (it != Vars.end() && it->second != pair.second) {
                 diffVars[pair.first] = pair.second;
@@ -289,69 +797,92 @@ namespace dial {
                 state->saveData.push_back("v:" + pair.first + " = " +  std::to_string((pair.second).first));   
             }
         }
-        for (auto& pair : Vars) {
-            state->globalVarsCopy[pair.first] = pair.second;
+        if (diffVars.empty()) { return; }
+        map<string, std::pair<int,string>>& globalVarsCopy = state->globalVarsCopy.Write(); /* updated in place, sharing the engine's map would make its next write copy all of it */
+        for (auto& pair : diffVars) {
+            auto it = Vars.find(pair.first);
+            if (it != Vars.end()) { globalVarsCopy[pair.first] = it->second; }
+            else                  { globalVarsCopy.erase(pair.first); }
+        }
+    }
+
+    bool BuiltinVarNumber (State* state, const string& key, int& number) { /* the variables the interpreter provides, computed on every read and never stored */
+        if (key == "TRUE")       { number = 1; }
+        elif (key == "FALSE")    { number = 0; }
+        elif (key == "REPEAT" || key == "ONCE") {
+            u32 counter_i = (u32)state->condCounter_i;
+            int repeat_c = (counter_i < state->condRepeat_c->size()) ? (*state->condRepeat_c)[counter_i] : 0;
+            number = (key == "REPEAT") ? repeat_c : !repeat_c;
         }
+        elif (key == "RANDOM") { /* generates number from 1 to 100 */
+            number = (state->randomDraw_c < state->randomTape.size()) ? state->randomTape[state->randomDraw_c] : (NextRandom(state) % 100) + 1;
+            state->randomDraw_c++;
+        }
+        else { return false; }
+        return true;
     }
 
-    std::pair<int,string>& GetVar (State* state, string key, bool isNegated) {
-        if (state == nullptr) { Error("Local variable was not available as the state was deleted; returning a global variable."); return Vars[key]; }
+    const std::pair<int,string>* FindVar (State* state, const string& key) { /* reads through the Cow, so the snapshots keep sharing the maps; nullptr when the variable was never written */
+        if (state == nullptr || key.length() == 0) { return nullptr; }
+        const map<string, std::pair<int,string>>& vars = (std::isupper((unsigned char)key[0])) ? *(state->engine->vars) : *(state->localVars);
+        auto it = vars.find(key);
+        return (it != vars.end()) ? &it->second : nullptr;
+    }
+
+    std::pair<int,string> GetVarValue (State* state, string key, bool isNegated) { /* "-Var" and "!Var" change the value that is read, not the variable */
         bool isNegative = false;
-		if (key.length() != 0 && key[0] == '-') {
-			isNegative = true;
-			key = key.substr(1, key.length() - 1);
-		}
-		if (key.length() != 0) {
-            if (key == "REPEAT")      { Vars[key].first =  state->condRepeat_c[state->currentPos.text_i]; Vars[key].second = ""; }
-            if (key == "ONCE")        { Vars[key].first = !state->condRepeat_c[state->currentPos.text_i]; Vars[key].second = ""; }
-            if (key == "TRUE")        { Vars[key].first = 1; Vars[key].second = ""; }
-            if (key == "FALSE")       { Vars[key].first = 0; Vars[key].second = ""; }
-            if (key == "RANDOM")      { Vars[key].first = (rand() % 100) + 1; Vars[key].second = ""; } /* generates number from 1 to 100*/
-            
-            if (std::isupper(key[0])) {
-				if (isNegative) {
-					Vars[key].first = (-1) * Vars[key].first;
-				}
-				if (isNegated) {
-					Vars[key].first = (int)(!Vars[key].first);					
-				}
-				return Vars[key];
-			}
-            else {
-				if (isNegative) {
-					(state->localVars[key]).first = (-1) * (state->localVars[key]).first;
-				}
-				if (isNegated) {
-					(state->localVars[key]).first = (int)(!(state->localVars[key]).first);					
-				}
-				return state->localVars[key]; 
-			}
+        if (key.length() != 0 && key[0] == '-') {
+            isNegative = true;
+            key = key.substr(1, key.length() - 1);
         }
-        else {
-            Error("Could not get a variable as its length is 0.", state->text, state->currentPos.text_i);
+        if (key.length() == 0) {
+            Error("Could not get a variable as its length is 0.", state->script, state->currentPos.text_i);
+            return std::make_pair(0, "");
+        }
+        std::pair<int,string> value(0, "");
+        if (!BuiltinVarNumber(state, key, value.first)) {
+            const std::pair<int,string>* var = FindVar(state, key);
+            if (var != nullptr) { value = *var; }
         }
-        return state->localVars[key];
+        if (isNegative) { value.first = (-1) * value.first; }
+        if (isNegated)  { value.first = (int)(!value.first); }
+        return value;
     }
 
-    void LoadJumpBases (State* state) {
-        if (state == nullptr) { return; }
+    std::pair<int,string>& GetVar (State* state, const string& key) { /* the variable to write to, created when it is missing */
+        if (state == nullptr) { Error("Local variable was not available as the state was deleted; returning a global variable."); return DefaultEngine.vars.Write()[key]; }
+        if (key.length() == 0) {
+            Error("Could not get a variable as its length is 0.", state->script, state->currentPos.text_i);
+        }
+        if (std::isupper((unsigned char)key[0])) {
+            return state->engine->vars.Write()[key];
+        }
+        return state->localVars.Write()[key];
+    }
 
-        char* txt = state->text;
-        u32& t_i = state->currentPos.text_i;
+    void LoadJumpBases (Script* script) {
+        if (script == nullptr) { return; }
+
+        const char* txt = script->text;
+        u32 t_i = 0;
         int condNestingDepth_b = 0;
 
         while (true) {
+            t_i = CommentEnd(script, t_i);
             switch (txt[t_i]) {
-                case '#': { SeekEndOfStatement(txt, t_i, "#"); break; }
-                case '@': { SeekEndOfStatement(txt, t_i, "@"); break; }
+                case '\0': { /* the end of the text without the |~ symbol */
+                    return;
+                }
+                case '#': { SeekEndOfStatement(script, t_i, "#"); break; }
+                case '@': { SeekEndOfStatement(script, t_i, "@"); break; }
                 case '{': { 
                     t_i++;
                     u32 potentialStartOfChoiceRangePos_i = t_i;
-                    SeekUntil(txt, t_i, "{}");
+                    SeekUntil(script, t_i, "{}");
                     if (txt[t_i] == '{') {
                         t_i = potentialStartOfChoiceRangePos_i;
                     }
-                    else {
+                    elif (txt[t_i] == '}') {
                         t_i++;
                     }
                     break;
@@ -360,11 +891,11 @@ namespace dial {
                     if (txt[t_i + 1] == '[') { /* [[...]] */
                         t_i++;
                         u32 beginningOfJumpBaseNumber_i = t_i;
-                        string jumpBaseNumberText = ScanTextUntil(txt, t_i, "-_ ]"); /* examples: [[20-desc.]] , [[7_the scene]] , [[6 plot branch]] , [[38]] */
+                        string jumpBaseNumberText = ScanTextUntil(script, t_i, "-_ ]"); /* examples: [[20-desc.]] , [[7_the scene]] , [[6 plot branch]] , [[38]] */
                         bool hasSucceeded; int jumpBaseNumber = stringToInt(jumpBaseNumberText, hasSucceeded);
                         if (hasSucceeded) {
                             t_i = beginningOfJumpBaseNumber_i;
-                            SeekUntil(txt, t_i, "]");
+                            SeekUntil(script, t_i, "]");
                             while (txt[t_i] == ']') { /* ]]*... */
                                 t_i++;
                             }
@@ -372,10 +903,10 @@ namespace dial {
                             Pos jumpBase_b;
                             jumpBase_b.text_i = t_i;
                             jumpBase_b.condNestingDepth = condNestingDepth_b;
-                            state->jumpBasePos[jumpBaseNumber] = jumpBase_b;
+                            script->jumpBasePos[jumpBaseNumber] = jumpBase_b;
                         }
                         else {
-                            Error("Following jump base number could not be interpreted: " + jumpBaseNumberText, txt, t_i);
+                            Error("Following jump base number could not be interpreted: " + jumpBaseNumberText, script, t_i);
                         }
                     }
                     else { /* [...] */
@@ -385,18 +916,17 @@ namespace dial {
                 }
                 case '&': {
                     condNestingDepth_b++;
-                    SeekEndOfStatement(txt, t_i, "&");
+                    SeekEndOfStatement(script, t_i, "&");
                     break;
                 }
                 case '|': {
                     if (txt[t_i + 1] == '~') { /* |~ */
-                        t_i = 0;
                         return;
                     }
                     elif (txt[t_i + 1] == '|') { /* || */
                         condNestingDepth_b--;
                         if (condNestingDepth_b < 0) {
-                            Error("Conditional nesting depth is below zero. There are stray '||' symbols.", txt, t_i);
+                            Error("Conditional nesting depth is below zero. There are stray '||' symbols.", script, t_i);
                             condNestingDepth_b = 0;
                         }
                         t_i += 2;
@@ -416,8 +946,8 @@ namespace dial {
         return (character == ' ' || character == '\t' || character == '\n' || character == '\r');
     }
 
-    string RemoveWhitespace (string dirtyText) {
-        string cleanText = "";
+    void RemoveWhitespace (std::string_view dirtyText, string& cleanText) { /* one pass into the caller's buffer, which keeps its capacity */
+        cleanText.clear();
         u32 text_i = 0;
         u32 text_s = dirtyText.length();
 
@@ -426,39 +956,27 @@ namespace dial {
             text_i++;
         }
 
-        /* changes tabs to spaces, but does not allow returns inside the cleanText */
+        /* removes tabs, changes returns to spaces and multiple adjacent spaces into a single space */
         while (text_i != text_s) {
-            if (dirtyText[text_i] == '\n' || dirtyText[text_i] == '\r') {
-                cleanText += ' ';
+            char character = dirtyText[text_i];
+            if (character == '\n' || character == '\r') {
+                character = ' ';
             }
-            elif (dirtyText[text_i] != '\t') {
-                cleanText += dirtyText[text_i];
+            if (character != '\t' && !(character == ' ' && cleanText.back() == ' ')) {
+                cleanText += character;
             }
             text_i++;
         }
+    }
 
-        /* changes multiple adjacent spaces into a single space */
-        string cleanSingleSpaceText = "";
-        u32 cleanText_s = cleanText.length();
-        text_i = 0;
-        while (text_i != cleanText_s) {
-            if (cleanText[text_i] == ' ') {
-                cleanSingleSpaceText += cleanText[text_i];
-                text_i++;
-                while (text_i != text_s && cleanText[text_i] == ' ') {
-                    text_i++;
-                }
-            }
-            else {
-                cleanSingleSpaceText += cleanText[text_i];
-                text_i++;
-            }
-        }
-        return cleanSingleSpaceText;
+    string RemoveWhitespace (const string& dirtyText) { /* the result is usually short enough to need no allocation */
+        string cleanText = "";
+        RemoveWhitespace(dirtyText, cleanText);
+        return cleanText;
     }
 
-    string DisplayTextInterpret (string text) {
-        string displayText = "";
+    void DisplayTextInterpret (std::string_view text, string& displayText) {
+        displayText.clear();
         u32 text_i = 0;
         u32 text_s = text.length();
 
@@ -468,7 +986,7 @@ namespace dial {
                 if (text_i == text_s) {
                     break;
                 }   
-                string specialChar = "";
+                const char* specialChar = "";
                 switch (text[text_i]) { /* special characters are preceded with a '\' character: '\A'  ->  '&' */
                     case 'A': specialChar = "&";       break;
                     case 'B': specialChar = "\\";      break;
@@ -487,9 +1005,7 @@ namespace dial {
                     case '4': specialChar = "}";       break;
                     default: Error("Incorrect special character declaration."); break;
                 }
-                if (specialChar != "") {
-                    displayText += specialChar;
-                }
+                displayText += specialChar;
             }
             else {
                 displayText += text[text_i];
@@ -497,35 +1013,42 @@ namespace dial {
             text_i++;
         }
         /* @TODO text formatting? *text* would be cursive, _text_ would be bold */
+    }
+
+    string DisplayTextInterpret (string text) {
+        string displayText = "";
+        DisplayTextInterpret(text, displayText);
         return displayText;
     }
 
-    string WrapText (string unwrapped, u32 width) {
-        string wrapped = "";
+    void WrapText (std::string_view unwrapped, u32 width, string& wrapped) {
+        thread_local string currentWord; /* keeps its capacity between the calls */
+        wrapped.clear();
+        currentWord.clear();
         u32 currentColumn_i = 0;
-        string currentWord = "";
         u32 unwrapped_s = unwrapped.length();
         if (width != 0) {
             for (u32 i = 0; i < unwrapped_s; i++) {
                 currentWord += unwrapped[i];
                 if (unwrapped[i] == ' ' && currentWord.length() > 3) { /* if a word has more than two characters and comes across a space */
                     wrapped += currentWord;
-                    currentWord = "";
+                    currentWord.clear();
                 }
                 if (currentWord.length() == width) { /* break it with at least 4 characters in new line */
                     if (width >= 10) {
-                        wrapped += currentWord.substr(0, width - 4);
+                        wrapped.append(currentWord, 0, width - 4);
                         char lastBreakChar = wrapped.back();
                         if (lastBreakChar != ' ' && lastBreakChar != '-') { /* @TODO non-breaking space character too? */
                             wrapped += '-';
                         }
                         wrapped += '\n';
-                        currentWord = currentWord.substr(width - 4, 4);
+                        currentWord.erase(0, width - 4);
                         currentColumn_i = 4;
                     }
                     else {
-                        wrapped += currentWord + '\n';
-                        currentWord = "";
+                        wrapped += currentWord;
+                        wrapped += '\n';
+                        currentWord.clear();
                         currentColumn_i = 0;
                     }
                 }
@@ -536,18 +1059,20 @@ namespace dial {
                 }
                 currentColumn_i++;
             }
-            if (currentWord != "") {
-                wrapped += currentWord;
-            }
+            wrapped += currentWord;
         }
         else {
             wrapped = unwrapped;
         }
-        
+    }
+
+    string WrapText (string unwrapped, u32 width) {
+        string wrapped = "";
+        WrapText(unwrapped, width, wrapped);
         return wrapped;
     }
 
-    bool IsTextVisible (string text) { /* determines whether the text has any non-whitespace character */
+    bool IsTextVisible (const string& text) { /* determines whether the text has any non-whitespace character */
         u32 text_i = 0; u32 text_s = text.length();
         while (text_i != text_s && IsWhitespace(text[text_i])) {
             text_i++;
@@ -559,9 +1084,40 @@ namespace dial {
 // // // SCAN, CHECK, SEEK FUNCTIONS // // //
 
 
-    void SeekUntil (char* txt, u32& t_i, string endingChars) { /* increments the text index until it comes across one of the characters inside the endingChars argument */
+    /* the scanning functions rely on the 0 that follows every script's text: they stop at it and never move past it, */
+    /* so a malformed script can't make them read beyond the buffer, and the fast path has no extra bounds check */
+
+    u32 CommentEnd (Script* script, u32 t_i) { /* the position right after the comment starting at t_i, or t_i when none starts there */
+        char character = script->text[t_i];
+        if (character != '/' && character != '*') { return t_i; } /* every comment starts with an opening or a stray closing symbol */
+        auto it = std::lower_bound(script->comments.begin(), script->comments.end(), std::make_pair(t_i, (u32)0));
+        return (it != script->comments.end() && it->first == t_i) ? it->second : t_i;
+    }
+
+    void SkipWhitespace (Script* script, u32& t_i) { /* a comment counts as whitespace */
+        while (true) {
+            t_i = CommentEnd(script, t_i);
+            if (!IsWhitespace(script->text[t_i])) { return; }
+            t_i++;
+        }
+    }
+
+    void TextWithoutComments (Script* script, u32 begin_i, u32 end_i, string& text) { /* the text between the positions, which aren't inside a comment */
+        text.clear();
+        auto it = std::lower_bound(script->comments.begin(), script->comments.end(), std::make_pair(begin_i, (u32)0));
+        for (; it != script->comments.end() && it->first < end_i; it++) {
+            text.append(script->text + begin_i, it->first - begin_i);
+            begin_i = std::min(it->second, end_i);
+        }
+        text.append(script->text + begin_i, end_i - begin_i);
+    }
+
+    void SeekUntil (Script* script, u32& t_i, string endingChars) { /* increments the text index until it comes across one of the characters inside the endingChars argument */
+        const char* txt = script->text;
         u32 chars_s = endingChars.length(); u32 i = 0;
         while (true) {
+            t_i = CommentEnd(script, t_i);
+            if (txt[t_i] == 0) { return; } /* stops at the terminating 0 when none of them comes */
             for (i = 0; i < chars_s; i++) {
                 if (txt[t_i] == endingChars[i]) { return; }
             }
@@ -569,17 +1125,22 @@ namespace dial {
         }
     }
 
-    void SeekEndOfConditional (char* txt, u32& t_i) {
+    void SeekEndOfConditional (Script* script, u32& t_i, bool isReported) {
+        const char* txt = script->text;
         /* &...&*.......||^..   * - starts here  ,  ^ - finishes there */
+        DIAL_PROF_SCOPE("SeekEndOfConditional");
+        #ifdef DIAL_PROFILE
+        u32 start_i = t_i;
+        #endif
         int nestingDepth_b = 0;
         while (true) {
-            SeekUntil(txt, t_i, "&|");
+            SeekUntil(script, t_i, "&|");
             if (txt[t_i] == '&') { /* &...& */
                 nestingDepth_b++;
-                SeekEndOfStatement(txt, t_i, "&");
+                SeekEndOfStatement(script, t_i, "&");
             }
-            elif (txt[t_i] == '|' && txt[t_i + 1] == '~') { /* |~ */
-                Error("A conditional doesn't have its corresponding '||' symbol.", txt, t_i);
+            elif (txt[t_i] == '\0' || (txt[t_i] == '|' && txt[t_i + 1] == '~')) { /* |~ or the end of the text */
+                if (isReported) { Error("A conditional doesn't have its corresponding '||' symbol.", script, t_i); }
                 break;
             }
             elif (txt[t_i] == '|' && txt[t_i + 1] == '|') { /* || */
@@ -591,22 +1152,28 @@ namespace dial {
                 t_i++;
             }
         }
+        DIAL_PROF_COUNT("scanned characters", t_i - start_i);
     }
 
-    void SeekEndOfChoiceRange (char* txt, u32& t_i) {
+    void SeekEndOfChoiceRange (Script* script, u32& t_i) {
+        const char* txt = script->text;
         /* seeks end of 'current' choice range we are in */
         /* ...{...*...{..}..{..{}..}..{..}..}.... */
+        DIAL_PROF_SCOPE("SeekEndOfChoiceRange");
+        #ifdef DIAL_PROFILE
+        u32 start_i = t_i;
+        #endif
         int nestingDepth_b = 0;
         u32 pos_i = t_i;
         while (true) {
-            SeekUntil(txt, t_i, "{}|");
+            SeekUntil(script, t_i, "{}|");
             if (txt[t_i] == '{') {
                 t_i++;
-                SeekUntil(txt, t_i, "{}");
+                SeekUntil(script, t_i, "{}");
 
                 if (txt[t_i] == '{') { /* {...{...}.... */
                     nestingDepth_b++;
-                    SeekEndOfStatement(txt, t_i, "}"); /* {...{...}*... */
+                    SeekEndOfStatement(script, t_i, "}"); /* {...{...}*... */
                 }
                 elif (txt[t_i] == '}') { /* {...}..... */
                     t_i++;
@@ -618,9 +1185,9 @@ namespace dial {
                 if (nestingDepth_b != 0) { nestingDepth_b--; }
                 else { break; }
             }
-            elif (txt[t_i] == '|' && txt[t_i + 1] == '~') {
+            elif (txt[t_i] == '\0' || (txt[t_i] == '|' && txt[t_i + 1] == '~')) { /* |~ or the end of the text */
                 t_i = pos_i;
-                Error("The choice isn't in any choice range.", txt, t_i);
+                Error("The choice isn't in any choice range.", script, t_i);
                 break;
             }
             elif (txt[t_i] == '|') {
@@ -628,21 +1195,26 @@ namespace dial {
             }
         }
         /* ...{.......{..}..{..{}..}..{..}..}*... */
+        DIAL_PROF_COUNT("scanned characters", t_i - start_i);
     }
 
-    void SeekEndOfStatement (char* txt, u32& t_i, string endingChar) {
+    void SeekEndOfStatement (Script* script, u32& t_i, string endingChar) {
+        const char* txt = script->text;
         t_i++; /* ?*....?.... */
-        SeekUntil(txt, t_i, endingChar);
-        t_i++; /* ?.....?*... */
+        SeekUntil(script, t_i, endingChar);
+        if (txt[t_i] != 0) { t_i++; } /* ?.....?*..., an unclosed statement ends at the end of the text */
     }
 
 
-    string ScanTextUntil (char* txt, u32& t_i, string endingChars) { /* return text until certain characters, modifies the t_i index! */
+    string ScanTextUntil (Script* script, u32& t_i, string endingChars) { /* return text until certain characters, modifies the t_i index! */
+        const char* txt = script->text;
         /* ! - beginning char   ,   ? - endingChar   ,   * - caret position   ,   . - text we want to store */
-        t_i++; /* !*....? */
+        if (txt[t_i] != 0) { t_i++; } /* !*....? */
         string storedText = "";
         u32 chars_s = endingChars.length(); u32 i = 0;
         while (true) {
+            t_i = CommentEnd(script, t_i);
+            if (txt[t_i] == 0) { break; } /* an unclosed text ends at the end of the text */
             for (i = 0; i < chars_s; i++) {
                 if (txt[t_i] == endingChars[i]) {
                     t_i++; /* !.....?* */
@@ -652,23 +1224,21 @@ namespace dial {
             storedText += txt[t_i];
             t_i++;
         }
+        return RemoveWhitespace(storedText);
     }
 
 
     /* checks for following scenario and returns true if so (can be any number of conditionals "&...&" before the "{...}" sequence): */
     /* &...&&...&&...&{...}..... */
-    bool IsItConditionalChoice (char* txt, u32 t_i) {
+    bool IsItConditionalChoice (Script* script, u32 t_i) {
+        const char* txt = script->text;
         /* * - caret position   ,   . - some text */
         /* &...&*...&&...&..... */       /* text index is at the caret position here, it is behind a '&' symbol */
-        while (IsWhitespace(txt[t_i])) {
-            t_i++;
-        }
+        SkipWhitespace(script, t_i);
         if (txt[t_i] == '&') {
             while (true) {
-                SeekEndOfStatement(txt, t_i, "&");
-                while (IsWhitespace(txt[t_i])) {
-                    t_i++;
-                }
+                SeekEndOfStatement(script, t_i, "&");
+                SkipWhitespace(script, t_i);
                 if (txt[t_i] != '&') {
                     break;
                 }
@@ -677,7 +1247,7 @@ namespace dial {
         /* &...&&...&&...&*.... */
         if (txt[t_i] == '{') {
             t_i++;
-            SeekUntil(txt, t_i, "{}");
+            SeekUntil(script, t_i, "{}");
             if (txt[t_i] == '}') {
                 return true;
             }
@@ -689,53 +1259,52 @@ namespace dial {
 // // // INSTRUCTION INTERPRETERS // // //
 
 
-    enum Operator { /* operator, its assigned number is the precedence */
-        OP_NONE,
-        OP_OR,OP_AND,
-        OP_EQ,OP_NEQ,OP_GT,OP_GE,OP_LT,OP_LE, /* for condInterpreter */
-        OP_ADD,OP_SUB,OP_MUL,OP_DIV,OP_MOD,OP_POW,  /* for both */
-        OP_NOT,OP_LEN,OP_STR,OP_MIN,OP_MAX,OP_SUBSTR,
-        OP_COMMA,OP_LP,OP_NLP,OP_RP,
-        OP_IS,OP_EADD,OP_ESUB,OP_EMUL,OP_EDIV,OP_EMOD,OP_EPOW  /* for varInterpreter */
+    struct OperatorName {
+        std::string_view text;
+        Operator op;
     };
 
-    Operator StringToOperator (string opText) {
+    constexpr OperatorName DIAL_OPERATOR_NAMES[] = {
         /* for condInterpreter */
-        if (opText == "OR")  { return OP_OR;  }
-        if (opText == "AND") { return OP_AND; }
-        if (opText == "(")   { return OP_LP;  }
-        if (opText == "!(")  { return OP_NLP; }
-        if (opText == ")")   { return OP_RP;  }
-        if (opText == "==")  { return OP_EQ;  }
-        if (opText == "!=")  { return OP_NEQ; }
-        if (opText == ">")   { return OP_GT;  }
-        if (opText == ">=")  { return OP_GE;  }
-        if (opText == "<")   { return OP_LT;  }
-        if (opText == "<=")  { return OP_LE;  }
+        {"OR", OP_OR}, {"AND", OP_AND}, {"(", OP_LP}, {"!(", OP_NLP}, {")", OP_RP},
+        {"==", OP_EQ}, {"!=", OP_NEQ}, {">", OP_GT}, {">=", OP_GE}, {"<", OP_LT}, {"<=", OP_LE},
         /* for varInterpreter */
-        if (opText == "=")   { return OP_IS;   }
-        if (opText == "+=")  { return OP_EADD; }
-        if (opText == "-=")  { return OP_ESUB; }
-        if (opText == "*=")  { return OP_EMUL; }
-        if (opText == "/=")  { return OP_EDIV; }
-        if (opText == "%=")  { return OP_EMOD; }
-        if (opText == "^=")  { return OP_EPOW; }
+        {"=", OP_IS}, {"+=", OP_EADD}, {"-=", OP_ESUB}, {"*=", OP_EMUL}, {"/=", OP_EDIV}, {"%=", OP_EMOD}, {"^=", OP_EPOW},
         /* for both */
-        if (opText == "+")   { return OP_ADD;   }
-        if (opText == "-")   { return OP_SUB;   }
-        if (opText == "*")   { return OP_MUL;   }
-        if (opText == "/")   { return OP_DIV;   }
-        if (opText == "%")   { return OP_MOD;   }
-        if (opText == "^")   { return OP_POW;   }
-        if (opText == ",")   { return OP_COMMA; }
-        if (opText == "NOT") { return OP_NOT;   }
-        if (opText == "LEN") { return OP_LEN;   }
-        if (opText == "STR") { return OP_STR;   }
-        if (opText == "MIN") { return OP_MIN;   }
-        if (opText == "MAX") { return OP_MAX;   }
-        if (opText == "SUBSTR") { return OP_SUBSTR;   }
-        
-        return OP_NONE;
+        {"+", OP_ADD}, {"-", OP_SUB}, {"*", OP_MUL}, {"/", OP_DIV}, {"%", OP_MOD}, {"^", OP_POW}, {",", OP_COMMA},
+        {"NOT", OP_NOT}, {"LEN", OP_LEN}, {"STR", OP_STR}, {"MIN", OP_MIN}, {"MAX", OP_MAX}, {"SUBSTR", OP_SUBSTR}
+    };
+
+    constexpr u32 OperatorHash (std::string_view text) { /* the first and last characters with the length tell every operator apart */
+        return ((u32)(unsigned char)text[0] * 29 + (u32)(unsigned char)text.back() * 18 + (u32)text.length()) & 63;
+    }
+
+    struct OperatorSlots {
+        OperatorName slots[64];
+    };
+
+    constexpr OperatorSlots OperatorSlotsBuild () {
+        OperatorSlots table = {};
+        for (const OperatorName& name : DIAL_OPERATOR_NAMES) {
+            table.slots[OperatorHash(name.text)] = name;
+        }
+        return table;
+    }
+
+    constexpr bool IsOperatorHashPerfect () {
+        for (const OperatorName& name : DIAL_OPERATOR_NAMES) {
+            if (OperatorSlotsBuild().slots[OperatorHash(name.text)].op != name.op) { return false; }
+        }
+        return true;
+    }
+    static_assert(IsOperatorHashPerfect(), "Two operators share a slot, OperatorHash has to be changed.");
+
+    constexpr OperatorSlots DIAL_OPERATOR_SLOTS = OperatorSlotsBuild();
+
+    Operator StringToOperator (std::string_view opText) {
+        if (opText.length() == 0) { return OP_NONE; }
+        const OperatorName& name = DIAL_OPERATOR_SLOTS.slots[OperatorHash(opText)];
+        return (name.text == opText) ? name.op : OP_NONE;
     }
     
     int OperatorPrecedence (Operator op) {
@@ -754,33 +1323,40 @@ namespace dial {
         }
     }
     
-    std::pair<int,string> Operation (State* state, std::pair<int,string> elementA, Operator op, std::pair<int,string> elementB) {
+    void CondElseSet (State* state, bool isElse) { /* an error can come before any conditional of the depth was interpreted */
+        while (state->currentPos.condNestingDepth >= (int)state->condElse.size()) {
+            state->condElse.push_back(false);
+        }
+        state->condElse[state->currentPos.condNestingDepth] = isElse;
+    }
+
+    int Operation (State* state, int numberA, Operator op, int numberB) {
         int number = 0;
         switch (op) {
-            case OP_EQ:  number = (int)(elementA.first == elementB.first); break;
-            case OP_NEQ: number = (int)(elementA.first != elementB.first); break;
-            case OP_AND: number = (int)(elementA.first && elementB.first); break;
-            case OP_OR:  number = (int)(elementA.first || elementB.first); break;
-            case OP_GT:  number = (int)(elementA.first >  elementB.first); break;
-            case OP_GE:  number = (int)(elementA.first >= elementB.first); break;
-            case OP_LT:  number = (int)(elementA.first <  elementB.first); break;
-            case OP_LE:  number = (int)(elementA.first <= elementB.first); break;
-            case OP_ADD: number = (elementA.first + elementB.first); break;
-            case OP_SUB: number = (elementA.first - elementB.first); break;
-            case OP_MUL: number = (elementA.first * elementB.first); break;
-            case OP_DIV: if (elementB.first != 0) { number = (elementA.first / elementB.first); } else { /* @TODO error divided by zero*/ } break;
-            case OP_MOD: number = (elementA.first % elementB.first); break;
-            case OP_POW: number = (int)pow(elementA.first, elementB.first); break;
-            case OP_MIN: number = std::min(elementA.first, elementB.first); break;
-            case OP_MAX: number = std::max(elementA.first, elementB.first); break;
+            case OP_EQ:  number = (int)(numberA == numberB); break;
+            case OP_NEQ: number = (int)(numberA != numberB); break;
+            case OP_AND: number = (int)(numberA && numberB); break;
+            case OP_OR:  number = (int)(numberA || numberB); break;
+            case OP_GT:  number = (int)(numberA >  numberB); break;
+            case OP_GE:  number = (int)(numberA >= numberB); break;
+            case OP_LT:  number = (int)(numberA <  numberB); break;
+            case OP_LE:  number = (int)(numberA <= numberB); break;
+            case OP_ADD: number = (int)((u32)numberA + (u32)numberB); break; /* wraps around instead of overflowing */
+            case OP_SUB: number = (int)((u32)numberA - (u32)numberB); break;
+            case OP_MUL: number = (int)((u32)numberA * (u32)numberB); break;
+            case OP_DIV: if (numberB == -1) { number = (int)(0u - (u32)numberA); } elif (numberB != 0) { number = (numberA / numberB); } else { /* @TODO error divided by zero*/ } break;
+            case OP_MOD: if (numberB != 0 && numberB != -1) { number = (numberA % numberB); } break;
+            case OP_POW: number = (int)std::clamp(pow(numberA, numberB), (double)INT_MIN, (double)INT_MAX); break;
+            case OP_MIN: number = std::min(numberA, numberB); break;
+            case OP_MAX: number = std::max(numberA, numberB); break;
             default: {
-                Error("Wrong operator inside the integer instruction.", state->text, state->currentPos.text_i);
-                state->condElse[state->currentPos.condNestingDepth] = true;
-                return std::make_pair(number, "");
+                Error("Wrong operator inside the integer instruction.", state->script, state->currentPos.text_i);
+                CondElseSet(state, true);
+                return number;
                 break;
             }
         }
-        return std::make_pair(number, "");
+        return number;
     }
     
     bool IsFunctionOperator (Operator op) {
@@ -803,53 +1379,54 @@ namespace dial {
         return false;
     }
 
-    vector<string> SplitInstrSegments (string instrText) { /* splits all instruction segments: "!(Var1 == Var2)"  ->  "!(" "Var1" "==" "Var2" ")" */
+    bool IsSpacedBetween (char symbolA, char symbolB, char symbolC) { /* whether a segment ends between symbolA and symbolB, symbolC follows symbolB */
+        return (symbolA == '(' && symbolB != ' ') ||
+               (symbolA != ' ' && symbolA != '!' && symbolB == '(') ||
+               (symbolA != ' ' && symbolB == '!' && symbolC == '(') ||
+               (symbolA != ' ' && symbolB == ')') ||
+               (symbolA == ')' && symbolB != ' ') ||
+               (symbolA != ' ' && symbolB == ',') ||
+               (symbolA == ',' && symbolB != ' ');
+    }
+
+    void SegmentStart (vector<string>& segments, u32& segment_c) { /* reuses a string left from an earlier split */
+        if (segment_c == segments.size()) { segments.emplace_back(); }
+        else { segments[segment_c].clear(); }
+        segment_c++;
+    }
+
+    void SplitInstrSegments (std::string_view instrText, vector<string>& segments) { /* splits all instruction segments in one pass: "!(Var1 == Var2)"  ->  "!(" "Var1" "==" "Var2" ")" */
+        u32 instrText_s = instrText.length();
+        u32 text_s = (instrText_s != 0 && instrText[instrText_s - 1] == ' ') ? instrText_s - 1 : instrText_s; /* a space at the end doesn't start a segment */
+        u32 segment_c = 0;
+        u32 run_i = 0;          /* the characters from here on aren't in the current segment yet */
+        bool isQuoted = false;  /* @TODO add the (') sign here too */
+        SegmentStart(segments, segment_c);
+        for (u32 i = 0; i < text_s; i++) {
+            char symbol = instrText[i];
+            if (symbol == ' ' && !isQuoted) {
+                segments[segment_c - 1].append(instrText.data() + run_i, i - run_i);
+                SegmentStart(segments, segment_c);
+                run_i = i + 1;
+                continue;
+            }
+            if (symbol == '"') {
+                isQuoted = !isQuoted;
+            }
+            if (i + 1 < text_s && IsSpacedBetween(symbol, instrText[i + 1], (i + 2 < instrText_s) ? instrText[i + 2] : '\0')) {
+                segments[segment_c - 1].append(instrText.data() + run_i, i + 1 - run_i);
+                run_i = i + 1;
+                if (isQuoted) { segments[segment_c - 1] += ' '; } /* the parentheses and commas are spaced inside quotes too */
+                else { SegmentStart(segments, segment_c); }
+            }
+        }
+        segments[segment_c - 1].append(instrText.data() + run_i, text_s - run_i);
+        segments.resize(segment_c);
+    }
+
+    vector<string> SplitInstrSegments (std::string_view instrText) {
         vector<string> segments;
-        u32 i = 0;
-        u32 instrText_s = instrText.size();
-        while (i + 1 < instrText_s) {
-            if ((instrText[i] == '(' && instrText[i + 1] != ' ') || 
-                (instrText[i] != ' ' && instrText[i] != '!' && instrText[i + 1] == '(') || 
-                (i + 2 < instrText_s && instrText[i] != ' ' && instrText[i + 1] == '!' && instrText[i + 2] == '(') || 
-                (instrText[i] != ' ' && instrText[i + 1] == ')') || 
-                (instrText[i] == ')' && instrText[i + 1] != ' ') || 
-                (instrText[i] != ' ' && instrText[i + 1] == ',') || 
-                (instrText[i] == ',' && instrText[i + 1] != ' ')) {
-                instrText.insert(i + 1, " ");
-                instrText_s++;
-            }
-            i++;
-        }
-        if (instrText.size() != 0 && instrText.back() == ' ') {
-            instrText.pop_back(); /* remove a space at the end (if there's one) */
-        }
-        i = 0; instrText_s = instrText.size(); 
-        string segmentText_b = ""; 
-        while (true) {
-            while (i != instrText_s && instrText[i] != ' ' && instrText[i] != '"') { /* @TODO add the (') sign here too */
-                segmentText_b += instrText[i];
-                i++;
-            }
-            if (i != instrText_s && instrText[i] == '"') {
-                segmentText_b += instrText[i];
-                i++;
-                while (i != instrText_s && instrText[i] != '"') { /* @TODO add the (') sign here too */
-                    segmentText_b += instrText[i];
-                    i++;
-                }
-                if (i != instrText_s) {
-                    segmentText_b += instrText[i];
-                    i++;
-                    if (i != instrText_s && instrText[i] != ' ') {
-                        continue;
-                    }
-                }
-            }
-            segments.push_back(segmentText_b);
-            segmentText_b = "";
-            if (i == instrText_s) { break; }
-            i++;
-        }
+        SplitInstrSegments(instrText, segments);
         return segments;
     }
 
@@ -876,284 +1453,486 @@ namespace dial {
                 string stringVal = varText.substr(1, varText_s - 2);
                 return std::make_pair(0, stringVal);
             }
-            return GetVar(state, varText, isNegated);
+            return GetVarValue(state, varText, isNegated);
         }
     }
     
-    std::pair<int,string> OperationsInterpret (State* state, vector<string> segments) {
+    Value NumberValue (int number) {
+        return {std::string_view(), number, false};
+    }
+
+    std::string_view ArenaText (std::pmr::memory_resource* arena, std::string_view textA, std::string_view textB = std::string_view()) { /* copies the texts one after another into the arena */
+        u32 text_s = textA.length() + textB.length();
+        char* text = (char*)arena->allocate(text_s + 1, 1);
+        if (textA.length() != 0) { std::memcpy(text, textA.data(), textA.length()); } /* an empty view may have no data */
+        if (textB.length() != 0) { std::memcpy(text + textA.length(), textB.data(), textB.length()); }
+        return std::string_view(text, text_s);
+    }
+
+    Token NumberToken (int number) {
+        return {OP_NONE, 0, number, false, false, false};
+    }
+
+    Token OperandToken (const string& segment, u32 segment_i) { /* a literal is classified here, so that the evaluation only has to read the variables */
+        Token token = NumberToken(0);
+        token.segment_i = segment_i;
+        bool isNegated = (segment.length() != 0 && segment[0] == '!');
+        std::string_view text = std::string_view(segment).substr(isNegated ? 1 : 0);
+
+        bool hasSucceeded;
+        int converted = stringToInt(string(text), hasSucceeded);
+        if (hasSucceeded) {
+            token.number = (isNegated) ? (int)(!converted) : converted;
+        }
+        elif (text.length() >= 2 && text[0] == '"' && text.back() == '"') { /* @TODO add (') characters alongside (") too */
+            token.isText = true;
+            token.isString = (text.length() != 2 || segment == "\"\""); /* "" makes an operation a string one too */
+        }
+        else {
+            token.isVariable = true;
+        }
+        return token;
+    }
+
+    std::string_view LiteralText (const string& segment) { /* "text" or !"text" without the quotes */
+        std::string_view text = std::string_view(segment).substr((segment[0] == '!') ? 1 : 0);
+        return text.substr(1, text.length() - 2);
+    }
+
+    bool ConstantVariable (const string& segment, int& number) { /* TRUE and FALSE, with their '!' and '-' prefixes, read the same in every state */
+        u32 name_i = 0;
+        bool isNegated = (segment.length() > name_i && segment[name_i] == '!');
+        if (isNegated) { name_i++; }
+        bool isNegative = (segment.length() > name_i && segment[name_i] == '-');
+        if (isNegative) { name_i++; }
+
+        std::string_view name = std::string_view(segment).substr(name_i);
+        if (name == "TRUE")     { number = 1; }
+        elif (name == "FALSE")  { number = 0; }
+        else { return false; }
+        if (isNegative) { number = -number; }
+        if (isNegated)  { number = (int)(!number); }
+        return true;
+    }
+
+    Value VariableValue (State* state, const string& segment) { /* the text stays valid until the variable is written to */
+        u32 name_i = 0;
+        bool isNegated = (segment.length() > name_i && segment[name_i] == '!');
+        if (isNegated) { name_i++; }
+        bool isNegative = (segment.length() > name_i && segment[name_i] == '-');
+        if (isNegative) { name_i++; }
+        if (segment.length() == name_i) {
+            Error("Could not get a variable as its length is 0.", state->script, state->currentPos.text_i);
+            return NumberValue(0);
+        }
+
+        string key_b;
+        const string& key = (name_i == 0) ? segment : (key_b = segment.substr(name_i));
+        std::string_view text;
+        int number = 0;
+        if (!BuiltinVarNumber(state, key, number)) {
+            const std::pair<int,string>* var = FindVar(state, key);
+            if (var != nullptr) {
+                text = std::string_view(var->second);
+                number = var->first;
+            }
+        }
+        if (isNegative) { number = (-1) * number; }
+        if (isNegated)  { number = (int)(!number); }
+        return {text, number, text.length() != 0};
+    }
+
+    Value TokenValue (State* state, const vector<string>& segments, const Token& token) {
+        if (token.isVariable) { return VariableValue(state, segments[token.segment_i]); }
+        if (token.isText)     { return {LiteralText(segments[token.segment_i]), 0, token.isString}; }
+        return NumberValue(token.number);
+    }
+
+    const char* TokensBuild (const vector<string>& segments, u32 segment_i, std::pmr::vector<Token>& output) { /* orders the segments starting from segment_i into postfix, returns the error text or nullptr */
         u32 segments_s = segments.size();
-        u32 segment_i = 0;
         
-        vector<string> output;
-        vector<string> operators;
+        std::pmr::vector<Token> operators(output.get_allocator().resource());
+        output.reserve(segments_s);
+        operators.reserve(segments_s);
         while (segment_i != segments_s) {
             Operator op = StringToOperator(segments[segment_i]);
+            Token token = {op, segment_i, 0, false, false, false};
             if (op == OP_NONE) { /* is a value */
-                output.push_back(segments[segment_i]);
+                output.push_back(OperandToken(segments[segment_i], segment_i));
             }
             elif (IsFunctionOperator(op)) {
-                operators.push_back(segments[segment_i]);
+                operators.push_back(token);
             }
             elif (op == OP_COMMA) {
-                while (!operators.empty() && StringToOperator(operators.back()) != OP_LP) {
+                while (!operators.empty() && operators.back().op != OP_LP) {
                     output.push_back(operators.back());
                     operators.pop_back();
                 }
                 if (operators.empty()) {
-                    Error("Lone comma outside of function parentheses.", state->text, state->currentPos.text_i);
-                    return std::make_pair(0, "");
+                    return "Lone comma outside of function parentheses.";
                 }
             }
             elif (op == OP_NLP) {
-                operators.push_back("NOT");
-                operators.push_back("(");
+                token.op = OP_NOT;
+                operators.push_back(token);
+                token.op = OP_LP;
+                operators.push_back(token);
             }
             elif (op == OP_LP) {
-                operators.push_back(segments[segment_i]);
+                operators.push_back(token);
             }
             elif (op == OP_RP) {
-                while (!operators.empty() && StringToOperator(operators.back()) != OP_LP) {
+                while (!operators.empty() && operators.back().op != OP_LP) {
                     output.push_back(operators.back());
                     operators.pop_back();
                 }
                 if (!operators.empty()) {
                     operators.pop_back();
-                    if (!operators.empty() && IsFunctionOperator(StringToOperator(operators.back()))) {
+                    if (!operators.empty() && IsFunctionOperator(operators.back().op)) {
                         output.push_back(operators.back());
                         operators.pop_back();
                     }
                 }
                 else {
-                    Error("Mismatched parentheses.", state->text, state->currentPos.text_i);
-                    return std::make_pair(0, "");
+                    return "Mismatched parentheses.";
                 }
             }
             else { /* is a non-parenthesis operator */
-                Operator op2 = OP_NONE;
-                if (!operators.empty()) {
-                    op2 = StringToOperator(operators.back());
-                }
-                while (!operators.empty() && op2 != OP_LP && ( OperatorPrecedence(op2) > OperatorPrecedence(op) || ( OperatorPrecedence(op2) == OperatorPrecedence(op) && !IsRightAssociativeOperator(op) ) )) {
-                    output.push_back(operators.back());
-                    operators.pop_back();
-                    if (!operators.empty()) {
-                        op2 = StringToOperator(operators.back());
-                    }
-                    else {
+                while (!operators.empty()) {
+                    Operator op2 = operators.back().op;
+                    if (op2 == OP_LP || !( OperatorPrecedence(op2) > OperatorPrecedence(op) || ( OperatorPrecedence(op2) == OperatorPrecedence(op) && !IsRightAssociativeOperator(op) ) )) {
                         break;
                     }
+                    output.push_back(operators.back());
+                    operators.pop_back();
                 }
-                operators.push_back(segments[segment_i]);
+                operators.push_back(token);
             }
             
             segment_i++;
         }
 
         while (!operators.empty()) {
-            Operator op = StringToOperator(operators.back());
+            Operator op = operators.back().op;
             if (op == OP_LP || op == OP_RP) {
-                Error("Mismatched parentheses.", state->text, state->currentPos.text_i);
-                return std::make_pair(0, "");
+                return "Mismatched parentheses.";
             }
             output.push_back(operators.back());
             operators.pop_back();
         }
-        
-        
-        u32 output_i = 0;
-        u32 output_s = output.size();
-        vector<string>                stackSegments;
-        vector<std::pair<int,string>> stackValues;
-        std::pair<int,string> elementA, elementB, elementC;
-        while (output_i != output_s) {
-            Operator op = StringToOperator(output[output_i]);
-            if (op == OP_NONE) {
-                stackSegments.push_back(output[output_i]); stackValues.push_back(GetValue(state, output[output_i]));
+        return nullptr;
+    }
+
+    bool ApplyOperator (State* state, Operator op, std::pmr::vector<Value>& stack) { /* replaces the operator's arguments on the stack by its result; without a state (when folding) it reports nothing and refuses what could fail */
+        std::pmr::memory_resource* arena = stack.get_allocator().resource();
+        Value elementA, elementB, elementC;
+        if (IsSingleArgumentOperator(op)) {
+            if (stack.empty()) { goto OperationError; } elementA = stack.back(); stack.pop_back();
+            switch (op) {
+                case OP_NOT: stack.push_back(NumberValue((int)(!elementA.number))); break;
+                case OP_LEN: stack.push_back(NumberValue(elementA.text.length())); break;
+                case OP_STR: stack.push_back({ArenaText(arena, std::to_string(elementA.number)), 0, true}); break;
+                default: break;
             }
-            else {
-                if (IsSingleArgumentOperator(op)) {
-                    if (stackValues.empty()) { goto OperationError; } elementA = stackValues.back(); stackValues.pop_back(); stackSegments.pop_back();
-                    switch (op) {
-                        case OP_NOT: {
-                            stackSegments.push_back("0"); stackValues.push_back(std::make_pair((int)(!(elementA.first)), ""));
-                            break;
-                        }
-                        case OP_LEN: {
-                            stackSegments.push_back("0"); stackValues.push_back(std::make_pair((elementA.second).length(), ""));
-                            break;
-                        }
-                        case OP_STR: {
-                            stackSegments.push_back("0"); stackValues.push_back(std::make_pair(0, std::to_string(elementA.first)));
-                            break;
-                        }
-                        default: break;
+        }
+        elif (IsTripleArgumentOperator(op)) {
+            if (stack.empty()) { goto OperationError; } elementA = stack.back(); stack.pop_back();
+            if (stack.empty()) { goto OperationError; } elementB = stack.back(); stack.pop_back();
+            if (stack.empty()) { goto OperationError; } elementC = stack.back(); stack.pop_back();
+            switch (op) {
+                case OP_SUBSTR: {
+                    if (elementB.number >= 0 && elementB.number <= (int)elementC.text.length()) {
+                        std::string_view text = elementC.text.substr(elementB.number, elementA.number);
+                        stack.push_back({text, 0, text.length() != 0});
                     }
-                }
-                elif (IsTripleArgumentOperator(op)) {
-                    if (stackValues.empty()) { goto OperationError; } elementA = stackValues.back(); stackValues.pop_back(); stackSegments.pop_back();
-                    if (stackValues.empty()) { goto OperationError; } elementB = stackValues.back(); stackValues.pop_back(); stackSegments.pop_back();
-                    if (stackValues.empty()) { goto OperationError; } elementC = stackValues.back(); stackValues.pop_back(); stackSegments.pop_back();
-                    switch (op) {
-                        case OP_SUBSTR: {
-                            if (elementB.first >= 0 && elementB.first <= (int)(elementC.second).length()) {
-                                stackSegments.push_back("0"); stackValues.push_back(std::make_pair(0, (elementC.second).substr(elementB.first, elementA.first)));
-                            }
-                            else {
-                                Error("Second argument in a substring operation is invalid.", state->text, state->currentPos.text_i);
-                                state->condElse[state->currentPos.condNestingDepth] = true;
-                                return std::make_pair(0, "");
-                            }
-                            break;
-                        }
-                        default: break;
+                    else {
+                        if (state == nullptr) { return false; }
+                        Error("Second argument in a substring operation is invalid.", state->script, state->currentPos.text_i);
+                        CondElseSet(state, true);
+                        return false;
                     }
+                    break;
                 }
-                else {
-                    bool isString = false;
-                    if (stackValues.empty()) { goto OperationError; } elementA = stackValues.back(); stackValues.pop_back();
-                    if (stackValues.empty()) { goto OperationError; } elementB = stackValues.back(); stackValues.pop_back();
-                    if (elementA.second != "" || elementB.second != "") {
-                        isString = true;
-                    }
-                    if (stackSegments.back() == "\"\"") { isString = true; } stackSegments.pop_back();
-                    if (stackSegments.back() == "\"\"") { isString = true; } stackSegments.pop_back();
-                    
-                    if (isString) { /* @TODO include (') characters for quotation */
-                        switch (op) {
-                            case OP_ADD: stackSegments.push_back("\"" + elementB.second + elementA.second + "\""); stackValues.push_back(std::make_pair(0, elementB.second + elementA.second)); break;
-                            case OP_EQ:  stackSegments.push_back("0"); stackValues.push_back(std::make_pair((int)(elementB.second == elementA.second), "")); break;
-                            case OP_NEQ: stackSegments.push_back("0"); stackValues.push_back(std::make_pair((int)(elementB.second != elementA.second), "")); break;
-                            default: {
-                                Error("Wrong operator inside the string instruction.", state->text, state->currentPos.text_i);
-                                state->condElse[state->currentPos.condNestingDepth] = true;
-                                return std::make_pair(0, "");
-                            }
-                        }
+                default: break;
+            }
+        }
+        else {
+            if (stack.empty()) { goto OperationError; } elementA = stack.back(); stack.pop_back();
+            if (stack.empty()) { goto OperationError; } elementB = stack.back(); stack.pop_back();
+            
+            if (elementA.isString || elementB.isString) { /* @TODO include (') characters for quotation */
+                switch (op) {
+                    case OP_ADD: stack.push_back({ArenaText(arena, elementB.text, elementA.text), 0, true}); break;
+                    case OP_EQ:  stack.push_back(NumberValue((int)(elementB.text == elementA.text))); break;
+                    case OP_NEQ: stack.push_back(NumberValue((int)(elementB.text != elementA.text))); break;
+                    default: {
+                        if (state == nullptr) { return false; }
+                        Error("Wrong operator inside the string instruction.", state->script, state->currentPos.text_i);
+                        CondElseSet(state, true);
+                        return false;
                     }
-					else {
-						if (IsRightAssociativeOperator(op)) {
-							stackSegments.push_back("0"); stackValues.push_back(Operation(state, elementA, op, elementB));
-						}
-						else {
-							stackSegments.push_back("0"); stackValues.push_back(Operation(state, elementB, op, elementA));
-						}
-					}
-                }
-            }    
-            output_i++;
+                }
+            }
+            elif (state == nullptr && (OperatorPrecedence(op) == 0 || (op == OP_MOD && elementA.number == 0))) { /* Operation would report it, or the remainder is undefined */
+                return false;
+            }
+            elif (IsRightAssociativeOperator(op)) {
+                stack.push_back(NumberValue(Operation(state, elementA.number, op, elementB.number)));
+            }
+            else {
+                stack.push_back(NumberValue(Operation(state, elementB.number, op, elementA.number)));
+            }
+        }
+        return true;
+        
+        OperationError:
+        
+        if (state == nullptr) { return false; }
+        Error("Invalid operation.", state->script, state->currentPos.text_i);
+        CondElseSet(state, true);
+        return false;
+    }
+
+    std::pair<int,string> TokensEvaluate (State* state, const vector<string>& segments, const std::pmr::vector<Token>& tokens) {
+        std::pmr::vector<Value> stack(ThreadArena()->resource);
+        stack.reserve(tokens.size());
+        for (const Token& token : tokens) {
+            if (token.op == OP_NONE) {
+                stack.push_back(TokenValue(state, segments, token));
+            }
+            elif (!ApplyOperator(state, token.op, stack)) {
+                return std::make_pair(0, "");
+            }
         }
         
-        if (stackValues.empty()) {
+        if (stack.empty()) {
             return std::make_pair(0, "");
         }
         else {
-            return stackValues.back();            
+            return std::make_pair(stack.back().number, string(stack.back().text));
+        }
+    }
+
+    std::pair<int,string> OperationsInterpret (State* state, const vector<string>& segments, u32 segment_i = 0) { /* evaluates the segments starting from segment_i */
+        std::pmr::vector<Token> tokens(ThreadArena()->resource);
+        const char* errText = TokensBuild(segments, segment_i, tokens);
+        if (errText != nullptr) {
+            Error(errText, state->script, state->currentPos.text_i);
+            return std::make_pair(0, "");
+        }
+        return TokensEvaluate(state, segments, tokens);
+    }
+
+    bool TokensFold (const vector<string>& segments, std::pmr::vector<Token>& tokens, bool& isConstant, int& constant) { /* replaces the parts made only of literals, TRUE and FALSE by their number, returns whether any was */
+        struct Operand {
+            u32 token_i;     /* where the tokens computing it start */
+            bool isConstant;
+            Value value;
+        };
+        std::pmr::monotonic_buffer_resource scratch;
+        std::pmr::vector<Token> folded(tokens.get_allocator().resource());
+        std::pmr::vector<Operand> operands(&scratch);
+        bool hasFolded = false;
+        isConstant = false;
+        for (const Token& token : tokens) {
+            if (token.op == OP_NONE) {
+                Token operand = token;
+                int number;
+                if (token.isVariable && ConstantVariable(segments[token.segment_i], number)) {
+                    operand = NumberToken(number);
+                    hasFolded = true;
+                }
+                Value value = (operand.isText) ? Value{LiteralText(segments[operand.segment_i]), 0, operand.isString} : NumberValue(operand.number);
+                operands.push_back({(u32)folded.size(), !operand.isVariable, value});
+                folded.push_back(operand);
+                continue;
+            }
+            
+            u32 argument_s = (IsSingleArgumentOperator(token.op)) ? 1 : (IsTripleArgumentOperator(token.op)) ? 3 : 2;
+            if (operands.size() < argument_s) { return false; } /* left as it is, the evaluation reports it */
+            u32 first_i = operands.size() - argument_s;
+            bool areConstant = true;
+            std::pmr::vector<Value> stack(&scratch);
+            for (u32 i = first_i; i < operands.size(); i++) {
+                areConstant = areConstant && operands[i].isConstant;
+                stack.push_back(operands[i].value);
+            }
+            Operand result = {operands[first_i].token_i, false, NumberValue(0)};
+            operands.resize(first_i);
+            if (areConstant && ApplyOperator(nullptr, token.op, stack)) {
+                result.isConstant = true;
+                result.value = stack.back();
+                if (!result.value.isString) { /* a string stays as it is, its parent may still fold it */
+                    folded.resize(result.token_i);
+                    folded.push_back(NumberToken(result.value.number));
+                    operands.push_back(result);
+                    hasFolded = true;
+                    continue;
+                }
+            }
+            folded.push_back(token);
+            operands.push_back(result);
         }
         
-        OperationError:
-        
-        Error("Invalid operation.", state->text, state->currentPos.text_i);
-        state->condElse[state->currentPos.condNestingDepth] = true;
-        return std::make_pair(0, "");
+        isConstant = (operands.size() == 1 && operands[0].isConstant);
+        constant = (isConstant) ? operands[0].value.number : 0;
+        tokens = folded;
+        return hasFolded;
     }
 
 
-    void VarInstrInterpret (State* state, string instrText) { /* variable instructions interpreter */
-        vector<string> segments = SplitInstrSegments(instrText);
+    void VarSegmentsInterpret (State* state, const vector<string>& segments, const std::pmr::vector<Token>* tokens = nullptr) { /* variable instructions interpreter */
+        DIAL_PROF_SCOPE("VarSegmentsInterpret");
         if (segments.size() == 1) { /* shortcuts used for setting variable to true/false or incrementing/decrementing */
             u32 segment_s = segments[0].length();
             if (segment_s >= 2 && segments[0][segment_s - 1] == '+' && segments[0][segment_s - 2] == '+') {
-                GetVar(state, segments[0].substr(0, segment_s - 2), false).first++; /* increment if ends with the '++' characters */
+                int& number = GetVar(state, segments[0].substr(0, segment_s - 2)).first; number = Operation(state, number, OP_ADD, 1); /* increment if ends with the '++' characters */
             }
             elif (segment_s >= 2 && segments[0][segment_s - 1] == '-' && segments[0][segment_s - 2] == '-') {
-                GetVar(state, segments[0].substr(0, segment_s - 2), false).first--; /* decrement if ends with the '--' characters */
+                int& number = GetVar(state, segments[0].substr(0, segment_s - 2)).first; number = Operation(state, number, OP_SUB, 1); /* decrement if ends with the '--' characters */
             }
             elif (segment_s >= 1 && segments[0][0] == '!') {
-                GetVar(state, segments[0].erase(0, 1), false).first = 0;            /* '!' at beginning sets to false; erase() gets rid of '!' character */
+                GetVar(state, segments[0].substr(1)).first = 0;              /* '!' at beginning sets to false; substr() gets rid of '!' character */
             }
             else {
-                GetVar(state, segments[0], false).first = 1;                        /* otherwise sets to true */
+                GetVar(state, segments[0]).first = 1;                        /* otherwise sets to true */
             }
         }
         elif (segments.size() >= 3) {
             string lVal = segments[0];
             Operator op = StringToOperator(segments[1]);
             if (op == OP_NONE) {
-                Error("No left-hand side value in a variable instruction.", state->text, state->currentPos.text_i);
+                Error("No left-hand side value in a variable instruction.", state->script, state->currentPos.text_i);
                 return;
             }
-            segments.erase(segments.begin()); segments.erase(segments.begin());
-            std::pair<int,string> rVal = OperationsInterpret(state, segments);
+            std::pair<int,string> rVal = (tokens != nullptr) ? TokensEvaluate(state, segments, *tokens) : OperationsInterpret(state, segments, 2);
             if (rVal.second != "") { /* @TODO include (') also alongside (")  */
                 switch (op) {
-                    case OP_IS:   GetVar(state, lVal, false).second =  rVal.second; break;
-                    case OP_EADD: GetVar(state, lVal, false).second += rVal.second; break;
-                    default: Error("Wrong operator inside the string variable instruction.", state->text, state->currentPos.text_i); break;
+                    case OP_IS:   GetVar(state, lVal).second =  rVal.second; break;
+                    case OP_EADD: GetVar(state, lVal).second += rVal.second; break;
+                    default: Error("Wrong operator inside the string variable instruction.", state->script, state->currentPos.text_i); break;
                 }
             }   
             else {
-                GetVar(state, lVal, false).second = "";
-                switch (op) {
-                    case OP_IS:   GetVar(state, lVal, false).first =  rVal.first; break;
-                    case OP_EADD: GetVar(state, lVal, false).first += rVal.first; break;
-                    case OP_ESUB: GetVar(state, lVal, false).first -= rVal.first; break;
-                    case OP_EMUL: GetVar(state, lVal, false).first *= rVal.first; break;
-                    case OP_EDIV: GetVar(state, lVal, false).first /= rVal.first; break;
-                    case OP_EMOD: GetVar(state, lVal, false).first %= rVal.first; break;
-                    default: Error("Wrong operator inside the integer variable instruction.", state->text, state->currentPos.text_i); break;
+                GetVar(state, lVal).second = "";
+                int& number = GetVar(state, lVal).first;
+                switch (op) { /* Operation keeps an overflow or a division by zero defined */
+                    case OP_IS:   number = rVal.first; break;
+                    case OP_EADD: number = Operation(state, number, OP_ADD, rVal.first); break;
+                    case OP_ESUB: number = Operation(state, number, OP_SUB, rVal.first); break;
+                    case OP_EMUL: number = Operation(state, number, OP_MUL, rVal.first); break;
+                    case OP_EDIV: number = Operation(state, number, OP_DIV, rVal.first); break;
+                    case OP_EMOD: number = Operation(state, number, OP_MOD, rVal.first); break;
+                    default: Error("Wrong operator inside the integer variable instruction.", state->script, state->currentPos.text_i); break;
                 }
             }
         }
     }
 
-    void SpecInstrInterpret (State* state, string instrText) { /* special instructions interpreter */
-        vector<string> segments = SplitInstrSegments(instrText);
-        u32 segments_s = segments.size();
+    void VarInstrInterpret (State* state, std::string_view instrText) {
+        vector<string> segments = std::move(state->segments_b); /* its strings keep their capacity from the last split */
+        SplitInstrSegments(instrText, segments);
+        VarSegmentsInterpret(state, segments);
+        state->segments_b = std::move(segments);
+    }
 
-        bool wasCommandFound = false;
-        bool hasEnoughArguments = true;
-        u32 textLength = segments[0].size();
-        while (textLength != 0 && !wasCommandFound) {
-            string textSegment = segments[0].substr(0, textLength);
+    enum SpecCommand {
+        SPEC_NONE, SPEC_DISPLAY, SPEC_SAVE, SPEC_INCLUDE, SPEC_RESET, SPEC_SPEED, SPEC_WAIT
+    };
+
+    constexpr std::string_view DIAL_SPEC_COMMANDS[] = {"", "DISPLAY", "SAVE", "INCLUDE", "RESET", "SPEED", "WAIT"}; /* indexed by SpecCommand */
+
+    constexpr SpecCommand StringToSpecCommand (std::string_view text) { /* a command may be abbreviated, the one sharing the longest prefix with the text wins and the earlier one on a tie: "S" is SAVE, "SP" is SPEED */
+        SpecCommand command = SPEC_NONE;
+        u32 prefix_s = 0;
+        for (u32 i = SPEC_DISPLAY; i <= SPEC_WAIT; i++) {
+            std::string_view name = DIAL_SPEC_COMMANDS[i];
+            u32 length = 0;
+            while (length < text.length() && length < name.length() && text[length] == name[length]) {
+                length++;
+            }
+            if (length > prefix_s) {
+                prefix_s = length;
+                command = (SpecCommand)i;
+            }
+        }
+        return command;
+    }
+    static_assert(StringToSpecCommand("S") == SPEC_SAVE && StringToSpecCommand("SP") == SPEC_SPEED && StringToSpecCommand("DISPLAYED") == SPEC_DISPLAY && StringToSpecCommand("X") == SPEC_NONE,
+                  "Special commands have to keep their abbreviations.");
 
+    void SpecSegmentsInterpret (State* state, const vector<string>& segments, const std::pmr::vector<Token>* tokens = nullptr) { /* special instructions interpreter */
+        DIAL_PROF_SCOPE("SpecSegmentsInterpret");
+        u32 segments_s = segments.size();
 
+        bool wasCommandFound = true;
+        bool hasEnoughArguments = true;
+        switch (StringToSpecCommand(segments[0])) {
             /* displays number in the text itself: "#Money = 50#I have @DISPLAY Money@ dollars."  ->  "I have 50 dollars." */
-            if (textSegment == string("DISPLAY").substr(0, textLength)) {
-                if (segments_s < 2) { hasEnoughArguments = false; break; }
-                segments.erase(segments.begin());
-                std::pair<int,string> varText = OperationsInterpret(state, segments);
+            case SPEC_DISPLAY: {
+                if (segments_s < 2) { hasEnoughArguments = false; wasCommandFound = false; break; }
+                std::pair<int,string> varText = (tokens != nullptr) ? TokensEvaluate(state, segments, *tokens) : OperationsInterpret(state, segments, 1);
                 if (varText.second != "") {
                     state->displayText += varText.second;
                 }
                 else {
                     state->displayText += std::to_string(varText.first);
                 }
-                wasCommandFound = true;
+                break;
             }
             /* saves the game to a file */
-            elif (textSegment == string("SAVE").substr(0, textLength)) {
-                wasCommandFound = true;
+            case SPEC_SAVE: {
+                break;
+            }
+            /* links the jump bases of another file, "@INCLUDE chapter2@" lets [5] jump to [[5]] in chapter2.dial; it is read when the script loads */
+            case SPEC_INCLUDE: {
+                if (segments_s < 2) { hasEnoughArguments = false; wasCommandFound = false; }
+                break;
             }
             /* resets the values of 'temporary' variables (those starting with lowercase) */
-            elif (textSegment == string("RESET").substr(0, textLength)) {
-                wasCommandFound = true;
+            case SPEC_RESET: {
+                break;
             }
-            elif (textSegment == string("WAIT").substr(0, textLength)) {
-                if (segments_s < 2) { hasEnoughArguments = false; break; }
+            /* sets the typewriter reveal speed in glyphs per second for the following texts, "@SPEED 0@" shows them at once */
+            case SPEC_SPEED: {
+                if (segments_s < 2) { hasEnoughArguments = false; wasCommandFound = false; break; }
+                string speedNumberText = segments[1];
+                bool hasSucceeded; int speedNumber = stringToInt(speedNumberText, hasSucceeded);
+                if (hasSucceeded && speedNumber >= 0) {
+                    state->textSpeed = (u32)speedNumber;
+                }
+                else {
+                    Error("Following number could not be interpreted inside the special instruction: " + speedNumberText, state->script, state->currentPos.text_i);
+                }
+                break;
+            }
+            case SPEC_WAIT: {
+                if (segments_s < 2) { hasEnoughArguments = false; wasCommandFound = false; break; }
                 string waitNumberText = segments[1];
-                bool hasSucceeded; u32 waitNumber = (u32)stringToInt(waitNumberText, hasSucceeded);
-                if (hasSucceeded) {
-                    waitNumber = waitNumber; /* @TODO remove later */
+                bool hasSucceeded; int waitNumber = stringToInt(waitNumberText, hasSucceeded);
+                if (hasSucceeded && waitNumber >= 0) { /* "@WAIT 500@" pauses the dialogue for 500 milliseconds */
+                    state->waitTime = waitNumber / 1000.0;
+                    state->status = Status::WAIT_FOR_TIME;
                 }
                 else {
-                    Error("Following number could not be interpreted inside the special instruction: " + waitNumberText, state->text, state->currentPos.text_i);
+                    Error("Following number could not be interpreted inside the special instruction: " + waitNumberText, state->script, state->currentPos.text_i);
                 }
-                wasCommandFound = true;
+                break;
+            }
+            default: {
+                wasCommandFound = false;
+                break;
             }
-            textLength--;
         }
-        if (!wasCommandFound)    { Error("Unspecified command inside the special instruction.", state->text, state->currentPos.text_i); }
-        if (!hasEnoughArguments) { Error("Not enough arguments inside the special instruction.", state->text, state->currentPos.text_i); }
+        if (!wasCommandFound)    { Error("Unspecified command inside the special instruction.", state->script, state->currentPos.text_i); }
+        if (!hasEnoughArguments) { Error("Not enough arguments inside the special instruction.", state->script, state->currentPos.text_i); }
+    }
+
+    void SpecInstrInterpret (State* state, std::string_view instrText) {
+        vector<string> segments = std::move(state->segments_b);
+        SplitInstrSegments(instrText, segments);
+        SpecSegmentsInterpret(state, segments);
+        state->segments_b = std::move(segments);
     }
 
     void PersCondInstrInterpret (State* state, string instrText) { /* $[5] Count < 5$ */
@@ -1192,14 +1971,31 @@ namespace dial {
         }
     }
     
+    void ChapterSwitch (State* state, Script* chapter) { /* the state takes over the chapter's reference */
+        if (chapter == state->script) {
+            ScriptRelease(chapter);
+            return;
+        }
+        ChapterTouch(state->script); /* the chapter being left stays loaded for a while */
+        ScriptRelease(state->script);
+        state->script = chapter;
+    }
+
     void JumpPointInstrInterpret (State* state, string instrText) {
         u32 instrText_s = instrText.length();
         if (instrText_s != 0 && instrText[0] == '~') {
-            u32 jumpHistory_s = state->jumpHistory.size();
+            const Chunked<Jump>& jumpHistory = state->jumpHistory;
+            u32 jumpHistory_s = jumpHistory.size();
             
             if (instrText_s == 1) {
                 if (jumpHistory_s != 0) {
-                    state->currentPos = (state->jumpHistory[jumpHistory_s - 1]).second;
+                    const Jump& jump = jumpHistory[jumpHistory_s - 1];
+                    if (jump.file_n != state->script->file_n) {
+                        Script* chapter = ChapterAcquire(jump.file_n);
+                        if (chapter == nullptr) { return; }
+                        ChapterSwitch(state, chapter);
+                    }
+                    state->currentPos = jumpHistory[jumpHistory_s - 1].pos;
                     state->condElse.clear(); /* resets the ELSE statement on all depths */
                 }
             }
@@ -1208,214 +2004,488 @@ namespace dial {
             
                 bool hasSucceeded; int jumpPointNumber_i = stringToInt(instrText, hasSucceeded);
                 if (hasSucceeded) {
-                    if (state->jumpBasePos.count(jumpPointNumber_i) != 0) { /* checks if there's a jump base with such number */
-                        for (u32 i = jumpHistory_s - 1; i >= 0; i--) {
-                            if ((state->jumpHistory[i]).first == jumpPointNumber_i) {
-                                state->currentPos = (state->jumpHistory[i]).second;
+                    if (state->script->jumpBasePos.count(jumpPointNumber_i) != 0 || state->script->linkedBases.count(jumpPointNumber_i) != 0) { /* checks if there's a jump base with such number */
+                        for (u32 i = jumpHistory_s; i-- > 0;) { /* the latest jump from the base first */
+                            if (jumpHistory[i].base_i == jumpPointNumber_i) {
+                                if (jumpHistory[i].file_n != state->script->file_n) {
+                                    Script* chapter = ChapterAcquire(jumpHistory[i].file_n);
+                                    if (chapter == nullptr) { return; }
+                                    ChapterSwitch(state, chapter);
+                                }
+                                state->currentPos = jumpHistory[i].pos;
                                 state->condElse.clear(); /* resets the ELSE statement on all depths */
                                 break;
                             }
                         }
                     }
                     else {
-                        Error("Couldn't perform the jump, there's no jump base with the following number: " + instrText, state->text, state->currentPos.text_i);
+                        Error("Couldn't perform the jump, there's no jump base with the following number: " + instrText, state->script, state->currentPos.text_i);
                     }
                 }
                 else {
-                    Error("Following jump point number could not be interpreted: " + instrText, state->text, state->currentPos.text_i);
+                    Error("Following jump point number could not be interpreted: " + instrText, state->script, state->currentPos.text_i);
                 }
             }
         }
         else {
+            string file_n = ""; /* [chapter2:5] jumps to [[5]] in chapter2.dial, it stays empty for a jump within the chapter */
+            u32 fileSeparator_i = instrText.find(':');
+            if (fileSeparator_i != (u32)string::npos) {
+                file_n = RemoveWhitespace(instrText.substr(0, fileSeparator_i));
+                instrText = instrText.substr(fileSeparator_i + 1);
+            }
+
             bool hasSucceeded; int jumpPointNumber_i = stringToInt(instrText, hasSucceeded);
             if (hasSucceeded) {
-                if (state->jumpBasePos.count(jumpPointNumber_i) != 0) { /* checks if there's a jump base with such number */
-                    state->jumpHistory.push_back(std::pair<int,Pos>(jumpPointNumber_i, state->currentPos));
-                    state->currentPos = state->jumpBasePos[jumpPointNumber_i];
+                if (file_n == "" && state->script->jumpBasePos.count(jumpPointNumber_i) == 0 && state->script->linkedBases.count(jumpPointNumber_i) != 0) {
+                    file_n = state->script->linkedBases.at(jumpPointNumber_i);
+                }
+                Script* chapter = state->script;
+                if (file_n != "" && file_n != state->script->file_n) { /* the chapter is loaded on its first jump */
+                    chapter = ChapterAcquire(file_n);
+                    if (chapter == nullptr) { return; }
+                }
+
+                if (chapter->jumpBasePos.count(jumpPointNumber_i) != 0) { /* checks if there's a jump base with such number */
+                    state->jumpHistory.push_back({jumpPointNumber_i, state->currentPos, state->script->file_n});
+                    if (chapter != state->script) {
+                        ChapterSwitch(state, chapter);
+                    }
+                    state->currentPos = chapter->jumpBasePos.at(jumpPointNumber_i);
                     state->condElse.clear(); /* resets the ELSE statement on all depths */
                 }
                 else {
-                    Error("Couldn't perform the jump, there's no jump base with the following number: " + instrText, state->text, state->currentPos.text_i);
+                    Error("Couldn't perform the jump, there's no jump base with the following number: " + instrText, state->script, state->currentPos.text_i);
+                    if (chapter != state->script) {
+                        ScriptRelease(chapter);
+                    }
                 }
             }
             else {
-                Error("Following jump point number could not be interpreted: " + instrText, state->text, state->currentPos.text_i);
+                Error("Following jump point number could not be interpreted: " + instrText, state->script, state->currentPos.text_i);
             }
         }
     }
 
-    bool CondInstrInterpret (State* state, string instrText) {  /* conditional instructions interpreter, returns if the condition is true or false */
-        if (instrText.length() != 0 && instrText[0] == '~') {
-            instrText.erase(0, 1); /* removes the '~' character used for the skip */
-        }
-
-        vector<string> segments = SplitInstrSegments(instrText);
-
+    bool CondSegmentsInterpret (State* state, const vector<string>& segments, const std::pmr::vector<Token>* tokens = nullptr) {  /* conditional instructions interpreter, returns if the condition is true or false */
+        DIAL_PROF_SCOPE("CondSegmentsInterpret");
         while (state->currentPos.condNestingDepth >= (int)state->condElse.size()) {
             state->condElse.push_back(false);
         }
-        if (segments[0] == "ELSE") {
+        u32 segment_i = 0;
+        if (segments.size() != 0 && segments[0] == "ELSE") {
             if (state->condElse[state->currentPos.condNestingDepth] == false) {
                 return false;
             }
             else {
-                segments.erase(segments.begin()); /* removes the 'ELSE' segment on the beginning */
+                segment_i++; /* skips the 'ELSE' segment on the beginning */
             }
         }
-        if (segments.size() == 0) {
+        if (segments.size() == segment_i) {
             state->condElse[state->currentPos.condNestingDepth] = false;
             return true;
         }
 
-        bool result = (bool)OperationsInterpret(state, segments).first;
+        bool result = (bool)((tokens != nullptr) ? TokensEvaluate(state, segments, *tokens) : OperationsInterpret(state, segments, segment_i)).first;
         state->condElse[state->currentPos.condNestingDepth] = !result; /* "ELSE" is always an opposite of the result */
         return result;
     }
+
+    bool CompiledCondInterpret (State* state, const Instr& instr) { /* a static conditional isn't evaluated, the others use their folded tokens */
+        if (instr.staticResult < 0) {
+            return CondSegmentsInterpret(state, instr.segments, (instr.tokens.empty()) ? nullptr : &instr.tokens);
+        }
+        DIAL_PROF_COUNT("static conditionals", 1);
+        while (state->currentPos.condNestingDepth >= (int)state->condElse.size()) {
+            state->condElse.push_back(false);
+        }
+        state->condElse[state->currentPos.condNestingDepth] = (instr.staticResult == 0);
+        return (instr.staticResult != 0);
+    }
+
+    bool CondInstrInterpret (State* state, std::string_view instrText) {
+        if (instrText.length() != 0 && instrText[0] == '~') {
+            instrText.remove_prefix(1); /* removes the '~' character used for the skip */
+        }
+        vector<string> segments = std::move(state->segments_b);
+        SplitInstrSegments(instrText, segments);
+        bool result = CondSegmentsInterpret(state, segments);
+        state->segments_b = std::move(segments);
+        return result;
+    }
+
+    Instr CompileInstr (Script* script, u32 instr_i, u32 end_i) { /* instr_i is at the opening symbol, end_i right after the closing one */
+        const char* txt = script->text;
+        Instr instr;
+        instr.end_i = end_i;
+        char closingSymbol = (txt[instr_i] == '[') ? ']' : txt[instr_i];
+        bool isClosed = (end_i - 1 > instr_i && txt[end_i - 1] == closingSymbol); /* an unclosed one runs until the end of the text */
+        TextWithoutComments(script, instr_i + 1, end_i - (u32)isClosed, instr.instrText);
+        instr.instrText = RemoveWhitespace(instr.instrText);
+        string segmentsText = instr.instrText;
+        if (txt[instr_i] == '&' && segmentsText.length() != 0 && segmentsText[0] == '~') {
+            segmentsText.erase(0, 1); /* the skip symbol isn't a part of the condition */
+        }
+        if (txt[instr_i] != '$' && txt[instr_i] != '[') { /* persistent conditionals and jumps are interpreted from their text */
+            instr.segments = SplitInstrSegments(segmentsText);
+        }
+        instr.counter_i = -1;
+        instr.staticResult = -1;
+        instr.skip_i = 0;
+        instr.isFolded = false;
+        u32 expression_i = 0; /* where the expression of a variable instruction or of @DISPLAY starts */
+        if (txt[instr_i] == '#' && instr.segments.size() >= 3) {
+            expression_i = 2;
+        }
+        elif (txt[instr_i] == '@' && instr.segments.size() >= 2 && StringToSpecCommand(instr.segments[0]) == SPEC_DISPLAY) {
+            expression_i = 1;
+        }
+        if (expression_i != 0 && TokensBuild(instr.segments, expression_i, instr.tokens) != nullptr) {
+            instr.tokens.clear(); /* the runtime reports the error */
+        }
+        if (txt[instr_i] == '&') {
+            bool isElse = (instr.segments.size() != 0 && instr.segments[0] == "ELSE");
+            bool isConstant = (instr.segments.size() == 0);
+            int constant = 1;
+            if (instr.segments.size() != (u32)isElse && TokensBuild(instr.segments, (u32)isElse, instr.tokens) == nullptr) {
+                instr.isFolded = TokensFold(instr.segments, instr.tokens, isConstant, constant);
+            }
+            else {
+                instr.tokens.clear(); /* the runtime reports the error */
+            }
+            if (IsItConditionalChoice(script, end_i)) { /* the choices evaluate it where they are listed */
+                return instr;
+            }
+            if (isConstant && !isElse) { /* an ELSE depends on the conditionals before it */
+                instr.staticResult = (constant != 0);
+            }
+            u32 skip_i = end_i;
+            SeekEndOfConditional(script, skip_i, false);
+            if (!(txt[skip_i] == '|' && txt[skip_i + 1] == '~')) {
+                instr.skip_i = skip_i;
+            }
+        }
+        return instr;
+    }
+
+    void CompileInstrs (Script* script) { /* compiles every instruction once, so that the states don't rescan and resplit them on every pass */
+        const char* txt = script->text;
+        script->counter_s = 0;
+        for (u32 i = CommentEnd(script, 0); i < script->text_s; i = CommentEnd(script, i + 1)) { /* every '}' may end a choice; a dense index per choice replaces lookups by position */
+            if (txt[i] == '}') {
+                script->choiceCounters[i + 1] = script->counter_s++;
+            }
+        }
+
+        u32 t_i = 0;
+        while ((t_i = CommentEnd(script, t_i)) < script->text_s) {
+            char symbol = txt[t_i];
+            if (symbol == '|' && txt[t_i + 1] == '~') { /* |~ */
+                return;
+            }
+            elif (symbol == '[' && txt[t_i + 1] == '[') { /* [[...]] is indexed by LoadJumpBases */
+                t_i += 2;
+            }
+            elif (symbol == '#' || symbol == '@' || symbol == '&' || symbol == '$' || symbol == '[') {
+                char closingSymbol = (symbol == '[') ? ']' : symbol;
+                u32 instr_i = t_i;
+                t_i++;
+                while ((t_i = CommentEnd(script, t_i)) < script->text_s && txt[t_i] != closingSymbol) {
+                    t_i++;
+                }
+                if (t_i == script->text_s) { /* unclosed instruction, the rest is left to the interpreter */
+                    return;
+                }
+                t_i++;
+                Instr& instr = script->instrs[instr_i];
+                instr = CompileInstr(script, instr_i, t_i);
+                if (symbol == '&') {
+                    instr.counter_i = script->counter_s++;
+                    #ifdef DIAL_DEBUG
+                    if (instr.staticResult == 0) {
+                        Warning("The condition is always false" + ((instr.skip_i != 0) ? ", the text until " + GetCurrentTextFilePos(script, instr.skip_i) + " is unreachable." : string(".")), script, instr_i);
+                    }
+                    elif (instr.staticResult == 1) {
+                        Warning("The condition is always true.", script, instr_i);
+                    }
+                    elif (instr.isFolded) {
+                        Warning("A constant part of the condition was folded.", script, instr_i);
+                    }
+                    #endif
+                }
+            }
+            else {
+                t_i++;
+            }
+        }
+    }
+
+    /* returns the compiled instruction at t_i and moves the index past it; an instruction outside the script's index is compiled into instr_b */
+    const Instr& GetInstr (State* state, u32& t_i, Instr& instr_b) {
+        const char* txt = state->script->text;
+        auto it = state->script->instrs.find(t_i);
+        if (it != state->script->instrs.end()) {
+            t_i = it->second.end_i;
+            return it->second;
+        }
+        u32 instr_i = t_i;
+        SeekEndOfStatement(state->script, t_i, (txt[instr_i] == '[') ? "]" : string(1, txt[instr_i]));
+        instr_b = CompileInstr(state->script, instr_i, t_i);
+        return instr_b;
+    }
     
-    void AddTextObject (State* state, string text, TextType type) {
+    void CountConditional (State* state, int counter_i) {
+        state->condCounter_i = -1;
+        if (counter_i < 0) { return; } /* a conditional compiled outside of the script's index isn't counted */
+        vector<int>& condRepeat_c = state->condRepeat_c.Write();
+        if ((u32)counter_i >= condRepeat_c.size()) { condRepeat_c.resize(counter_i + 1, 0); } /* a chapter loaded later has higher indices */
+        condRepeat_c[counter_i]++;
+    }
+
+    bool IsCounterFlagSet (State* state, int counter_i) {
+        return counter_i >= 0 && (u32)counter_i < state->hasOneUseChoiceRecurred->size() && (*state->hasOneUseChoiceRecurred)[counter_i];
+    }
+
+    void AddTextObject (State* state, const string& text, TextType type) {
         if (state == nullptr) { return; }
         TextObject textObj;
+        if (state->textObjs_b.size() != 0) {
+            textObj = std::move(state->textObjs_b.back());
+            state->textObjs_b.pop_back();
+        }
         textObj.actor_n = state->actor_n;
         textObj.text    = text;
         textObj.type    = type;
+        textObj.revealSpeed = (type == TextType::NORMAL) ? state->textSpeed : 0;
         
-        state->textObjs.push_back(textObj);
+        state->textObjs.push_back(std::move(textObj));
     }
     
+    void SinkNotify (State* state, SinkEvent event) {
+        if (state->isSpeculative || state->sink.onEvent == nullptr) { return; }
+        state->sink.onEvent(state, event, state->sink.user);
+    }
+
+    Sink NullSink () {
+        return {nullptr, nullptr};
+    }
+
+    void ConsoleSinkEvent (State* state, SinkEvent event, void* user) { /* composes the output and writes it at once, without flushing line by line */
+        thread_local string buffer; /* keeps its capacity between the events */
+        const Chunked<TextObject>& textObjs = state->textObjs;
+        u32 textObjs_s = textObjs.size();
+        u32 choices_s = std::min((u32)state->choices.size(), textObjs_s);
+        buffer.clear();
+        switch (event) {
+            case SinkEvent::TEXT_SHOWN: {
+                if (textObjs_s != 0) { buffer += textObjs.back().text + '\n'; }
+                break;
+            }
+            case SinkEvent::CHOICES_SHOWN: {
+                for (u32 i = textObjs_s - choices_s; i < textObjs_s; i++) {
+                    buffer += textObjs[i].text + '\n';
+                }
+                break;
+            }
+            case SinkEvent::ACCENT_CHANGED:
+            case SinkEvent::TEXTS_REPLACED: {
+                buffer += "\033[2J\033[H"; /* clears the console with an ANSI escape and prints everything again */
+                for (u32 i = 0; i < textObjs_s; i++) {
+                    buffer += textObjs[i].text + '\n';
+                }
+                break;
+            }
+            case SinkEvent::FINISHED: {
+                buffer += "\n-END OF TRANSMISSION-\n";
+                break;
+            }
+        }
+        fwrite(buffer.data(), 1, buffer.length(), (FILE*)user);
+    }
+
+    Sink ConsoleSink (FILE* file) {
+        return {ConsoleSinkEvent, file};
+    }
+
+    void RendererSinkEvent (State* state, SinkEvent event, void* user) { /* only marks what the renderer has to rebuild, it does no I/O */
+        RenderChanges* changes = (RenderChanges*)user;
+        u32 textObjs_s = state->textObjs->size();
+        u32 choices_s = std::min((u32)state->choices.size(), textObjs_s);
+        u32 changed_i = 0;
+        switch (event) {
+            case SinkEvent::TEXT_SHOWN: { changed_i = (textObjs_s != 0) ? textObjs_s - 1 : 0; break; }
+            case SinkEvent::CHOICES_SHOWN:
+            case SinkEvent::ACCENT_CHANGED: { changed_i = textObjs_s - choices_s; break; }
+            case SinkEvent::TEXTS_REPLACED: { changed_i = 0; break; }
+            case SinkEvent::FINISHED: { changes->isFinished = true; return; }
+        }
+        changes->firstChanged_i = (changes->isChanged) ? std::min(changes->firstChanged_i, changed_i) : changed_i;
+        changes->isChanged = true;
+    }
+
+    Sink RendererSink (RenderChanges* changes) {
+        return {RendererSinkEvent, changes};
+    }
+
     void ShowRefreshedText (State* state) {
         if (state == nullptr) { return; }
-        system("cls");
-        for (u32 i = 0; i < state->textObjs.size(); i++) {
-            std::cout<<state->textObjs[i].text<<'\n';
-        }
+        SinkNotify(state, SinkEvent::TEXTS_REPLACED);
     }
 
     string ChoiceNumberPrefix (u32 index) {
         return "{" + std::to_string(index + 1) + "} ";
     }
 
-    void RefreshAccentedChoices (State* state) {
+    const string& CurrentAccentName (State* state) { /* "" when no accent is offered, the iterator isn't valid then */
+        static const string noAccent = "";
+        return (state->possibleAccents.size() != 0) ? *(state->currentAccent) : noAccent;
+    }
+
+    void AccentedChoicesUpdate (State* state) { /* rewrites the shown accented choices for the current accent */
         if (state == nullptr) { return; }
         u32 textObjs_s = state->textObjs.size();
         u32 choices_s = state->choices.size();
         for (u32 i = 0; i < choices_s; i++) {
             if (state->choices[i].type == TextType::CHOICE_ACCENTED) {
-                if (state->choices[i].accentedOptions.count(*(state->currentAccent)) != 0) { /* does the choice has current accent */
-                    state->choices[i].displayText = state->choices[i].accentedOptions[*(state->currentAccent)];
+                if (state->choices[i].accentedOptions.count(CurrentAccentName(state)) != 0) { /* does the choice has current accent */
+                    state->choices[i].displayText = state->choices[i].accentedOptions[CurrentAccentName(state)];
                     string choiceNumberedText = ChoiceNumberPrefix(i) + state->choices[i].displayText;
-                    state->textObjs[textObjs_s - choices_s + i].text = choiceNumberedText;
+                    state->textObjs.Write(textObjs_s - choices_s + i).text = choiceNumberedText;
                 }
                 else { /* the accented option is unavailable for current accent */
                     string choiceNumberedText = ChoiceNumberPrefix(i) + "<Unavailable.>";
-                    state->textObjs[textObjs_s - choices_s + i].text = choiceNumberedText;
+                    state->textObjs.Write(textObjs_s - choices_s + i).text = choiceNumberedText;
                 }
             }
         }
-        ShowRefreshedText(state);
     }
 
-    void ShowText (State* state, string text) {
+    void RefreshAccentedChoices (State* state) {
         if (state == nullptr) { return; }
-        text = RemoveWhitespace(text);
-        text = DisplayTextInterpret(text);
-        text = WrapText(text, state->textWidth);
-        
-        AddTextObject(state, text, TextType::NORMAL);
-        std::cout<<text<<std::endl;
+        AccentedChoicesUpdate(state);
+        SinkNotify(state, SinkEvent::ACCENT_CHANGED);
+    }
 
-        #ifdef DIAL_DEBUG
-        isBacktrackLocked = false;
-        #endif
+    void ShowText (State* state, const string& displayText) {
+        DIAL_PROF_SCOPE("ShowText");
+        if (state == nullptr) { return; }
+        thread_local string text_b; /* the buffers keep their capacity, only the shown text is allocated */
+        thread_local string wrapped_b;
+        RemoveWhitespace(displayText, wrapped_b);
+        DisplayTextInterpret(wrapped_b, text_b);
+        WrapText(text_b, state->textWidth, wrapped_b);
+        
+        AddTextObject(state, wrapped_b, TextType::NORMAL);
+        SinkNotify(state, SinkEvent::TEXT_SHOWN);
     }
 
     void ShowChoices (State* state) {
         if (state == nullptr) { return; }
-        string choiceText = "";
+        thread_local string text_b;
+        thread_local string wrapped_b;
         u32 choices_s = state->choices.size();
         for (u32 i = 0; i < choices_s; i++) {
-            choiceText = state->choices[i].displayText;
-            choiceText = DisplayTextInterpret(choiceText);
-            choiceText = WrapText(choiceText, state->textWidth);
+            DisplayTextInterpret(state->choices[i].displayText, text_b);
+            WrapText(text_b, state->textWidth, wrapped_b);
 
-            string numberedChoiceText = ChoiceNumberPrefix(i) + choiceText;
+            text_b = ChoiceNumberPrefix(i);
+            text_b += wrapped_b;
 
-            AddTextObject(state, numberedChoiceText, state->choices[i].type);
-            std::cout<<numberedChoiceText<<'\n';
+            AddTextObject(state, text_b, state->choices[i].type);
         }
-        RefreshAccentedChoices(state);
+        AccentedChoicesUpdate(state);
+        SinkNotify(state, SinkEvent::CHOICES_SHOWN);
     }
     
-    /* interprets the instrText and assigns values to the displayText, type and accentedOptions of state's choices */
+    void ChoicesClear (State* state) { /* the objects wait in choices_b for the next choice range */
+        while (state->choices.size() != 0) {
+            state->choices_b.push_back(std::move(state->choices.back()));
+            state->choices.pop_back();
+        }
+    }
+
+    ChoiceObject& ChoiceAdd (State* state) {
+        if (state->choices_b.size() == 0) {
+            state->choices.emplace_back();
+        }
+        else {
+            state->choices.push_back(std::move(state->choices_b.back()));
+            state->choices_b.pop_back();
+        }
+        return state->choices.back();
+    }
+
+    /* interprets the choices' text in the script and assigns values to their displayText, type and accentedOptions */
     void ChoicesInterpret (State* state) {
+        DIAL_PROF_SCOPE("ChoicesInterpret");
+        thread_local string analysedChoiceText; /* keeps its capacity between the choices */
+        const char* txt = state->script->text;
+        Pos pos_b = state->currentPos;
+        u32 condElse_s = state->condElse.size();
+        u32 choiceDepth = std::max(condElse_s, (u32)pos_b.condNestingDepth + 1); /* the conditionals inside a choice use the depths above the ones in use */
         u32 choices_s = state->choices.size();
         for (u32 i = 0; i < choices_s; i++) {
-            string choiceText = state->choices[i].instrText;
-            u32 choiceText_s = choiceText.length();
-            if (choiceText_s != 0 && choiceText[0] == '~') {
-                choiceText.erase(0, 1);
+            ChoiceObject& choice = state->choices[i];
+            u32 t_i = choice.text_i + 1;
+            u32 end_i = choice.jumpPos.text_i - 1; /* at the choice's '}' */
+            SkipWhitespace(state->script, t_i);
+            if (txt[t_i] == '~') {
+                t_i++;
             }
-            
-            string analysedChoiceText = "";
-            /* scan for conditionals inside the choice */
-            if (choiceText_s != 0) {
-                State* state_b = new State();
-                state_b->text = new char[choiceText_s + 3];
-                std::strcpy(state_b->text, choiceText.c_str());
-                state_b->text[choiceText_s] = '|';
-                state_b->text[choiceText_s + 1] = '~';
-                state_b->text[choiceText_s + 2] = 0;
-                
-                state_b->currentPos.text_i = 0;
-                state_b->currentPos.condNestingDepth = 0;
-                char* txt = state_b->text;
-                u32& t_i = state_b->currentPos.text_i;
-                while (t_i < choiceText_s) {
-                    switch (txt[t_i]) {
-                        case '&': { 
-                            /* @TODO make REPEAT variable available, hard to make it work though without making the code dirty */
-                            string instrText = ScanTextUntil(txt, t_i, "&");
-                            if (IsItConditionalChoice(txt, t_i)) {
-                                SeekEndOfChoiceRange(txt, t_i);
-                            }
-                            else {
-                                bool isConditionTrue = CondInstrInterpret(state_b, instrText);
-                                if (isConditionTrue) {
-                                    state_b->currentPos.condNestingDepth++;
-                                }
-                                else {
-                                    SeekEndOfConditional(txt, t_i);
-                                }
-                            }
-                            break;
+
+            /* scan for conditionals inside the choice, they were compiled with the script */
+            analysedChoiceText.clear();
+            state->currentPos.condNestingDepth = choiceDepth;
+            state->condElse.resize(choiceDepth); /* no ELSE carries over from the choice before */
+            state->condCounter_i = -1; /* @TODO make REPEAT variable available, hard to make it work though without making the code dirty */
+            while ((t_i = CommentEnd(state->script, t_i)) < end_i) {
+                switch (txt[t_i]) {
+                    case '&': { 
+                        state->currentPos.text_i = t_i;
+                        Instr instr_b;
+                        const Instr& instr = GetInstr(state, t_i, instr_b);
+                        bool isConditionTrue = CompiledCondInterpret(state, instr);
+                        if (isConditionTrue) {
+                            state->currentPos.condNestingDepth++;
                         }
-                        case '|': { 
-                            if (txt[t_i + 1] == '|') { /* || */
-                                t_i += 2;
-                                state_b->currentPos.condNestingDepth--;
-                            }
-                            else { /* | */
-                                analysedChoiceText += txt[t_i];
-                                t_i++;
+                        else {
+                            SeekEndOfConditional(state->script, t_i, false);
+                            if (t_i > end_i) {
+                                Error("A conditional inside the choice doesn't have its corresponding '||' symbol.", state->script, state->currentPos.text_i);
+                                t_i = end_i;
                             }
-                            break;
                         }
-                        default: { 
+                        break;
+                    }
+                    case '|': { 
+                        if (txt[t_i + 1] == '|') { /* || */
+                            t_i += 2;
+                            if (state->currentPos.condNestingDepth > (int)choiceDepth) { state->currentPos.condNestingDepth--; } /* a stray '||' */
+                        }
+                        else { /* | */
                             analysedChoiceText += txt[t_i];
                             t_i++;
-                            break;
                         }
+                        break;
+                    }
+                    default: { 
+                        analysedChoiceText += txt[t_i];
+                        t_i++;
+                        break;
                     }
                 }
-                delete[] state_b->text;
-                delete state_b;
             }
-            
-            choiceText = RemoveWhitespace(analysedChoiceText);
+            state->currentPos = pos_b;
+            state->condElse.resize(condElse_s);
+
+            RemoveWhitespace(analysedChoiceText, choice.displayText);
+            const string& choiceText = choice.displayText;
+            choice.accentedOptions.clear();
             TextType choiceType = TextType::CHOICE_NORMAL;
             
             if (choiceText[0] == '|') { /* accented choice */
                 choiceType = TextType::CHOICE_ACCENTED;
-                choiceText_s = choiceText.length();
+                u32 choiceText_s = choiceText.length();
                 u32 t_i = 1;
                 string accentName = "";
                 string accentedText = "";
@@ -1437,27 +2507,27 @@ namespace dial {
                         }
                         
                         if (std::isupper(accentName[0])) { 
-                            Error("Accented choice option's first character must be lowercase as it has to be a local variable.", state->text, state->currentPos.text_i);
+                            Error("Accented choice option's first character must be lowercase as it has to be a local variable.", state->script, state->currentPos.text_i);
                             break;
                         }
                         else {
-                            state->localVars[accentName] = std::make_pair(0, "");
+                            const std::pair<int,string>* accentVar = FindVar(state, accentName);
+                            if (accentVar == nullptr || *accentVar != std::make_pair(0, string())) { state->localVars.Write()[accentName] = std::make_pair(0, ""); } /* unchanged on the later passes, the snapshots keep sharing the map */
                         }
-                        state->choices[i].accentedOptions[accentName] = accentedText;
+                        choice.accentedOptions[accentName] = accentedText;
                         accentName = "";
                         accentedText = "";
                     }
                     else {
-                        Error("The accented choice option doesn't have its corresponding text; it might be missing a space after the accent's name.", state->text, state->currentPos.text_i);
+                        Error("The accented choice option doesn't have its corresponding text; it might be missing a space after the accent's name.", state->script, state->currentPos.text_i);
                         break;
                     }
                 }
-                choiceText = "";
+                choice.displayText.clear();
             }
             /* @TODO else if '%' for chance? */
 
-            state->choices[i].displayText = choiceText;
-            state->choices[i].type = choiceType;
+            choice.type = choiceType;
         }
         state->possibleAccents.clear();
         bool hasAccentedChoice = false;
@@ -1481,10 +2551,10 @@ namespace dial {
     }
     
     bool IsChoiceValid (State* state, int choice_i) {
-        if (state == nullptr) { return false; }
+        if (state == nullptr || choice_i < 0 || choice_i >= (int)state->choices.size()) { return false; }
         
         if (state->choices[choice_i].type == dial::TextType::CHOICE_ACCENTED) {
-            std::string currentAccentName = *(state->currentAccent);
+            std::string currentAccentName = CurrentAccentName(state);
             if (state->choices[choice_i].accentedOptions.count(currentAccentName) == 0) {
                 return false;
             }
@@ -1493,12 +2563,12 @@ namespace dial {
 
     }
     void Choice (State* state, int choice_i) {
-        if (state == nullptr) { return; }
+        if (state == nullptr || choice_i < 0 || choice_i >= (int)state->choices.size()) { return; }
         
         if (state->choices[choice_i].type == dial::TextType::CHOICE_ACCENTED) {
-            std::string currentAccentName = *(state->currentAccent);
+            std::string currentAccentName = CurrentAccentName(state);
             if (state->choices[choice_i].accentedOptions.count(currentAccentName) != 0) {
-                state->localVars[currentAccentName] = std::make_pair(1, "");
+                state->localVars.Write()[currentAccentName] = std::make_pair(1, "");
                 state->saveData.push_back("a:" + currentAccentName);
             }
             else { /* ignores the user's choice as this accented choice is unavailable */
@@ -1506,11 +2576,17 @@ namespace dial {
             }
         }
         
-        int choicePos_i = state->choices[choice_i].jumpPos.text_i;
-        state->hasOneUseChoiceRecurred[choicePos_i] = true;
+        int counter_i = state->choices[choice_i].counter_i;
+        if (counter_i >= 0) {
+            vector<bool>& hasOneUseChoiceRecurred = state->hasOneUseChoiceRecurred.Write();
+            if ((u32)counter_i >= hasOneUseChoiceRecurred.size()) { hasOneUseChoiceRecurred.resize(counter_i + 1, false); }
+            hasOneUseChoiceRecurred[counter_i] = true;
+        }
          
-        while (state->textObjs.size() != 0 && state->textObjs.back().type != dial::TextType::NORMAL && state->textObjs.back().type != dial::TextType::CHOICE_SELECTED) { /* deletes until texttype == normal or size is 0 */
-            state->textObjs.pop_back();
+        Chunked<TextObject>& textObjs = state->textObjs;
+        while (textObjs.size() != 0 && textObjs.back().type != dial::TextType::NORMAL && textObjs.back().type != dial::TextType::CHOICE_SELECTED) { /* deletes until texttype == normal or size is 0 */
+            state->textObjs_b.push_back(std::move(textObjs.Write(textObjs.size() - 1)));
+            textObjs.pop_back();
         }
         dial::AddTextObject(state, state->choices[choice_i].displayText, dial::TextType::CHOICE_SELECTED);
         
@@ -1529,6 +2605,18 @@ namespace dial {
         state->status = dial::Status::INTERPRET;
     }
     
+    /* advances the WAIT_FOR_TIME status by the given amount of seconds; the caller owns the clock, so a virtual clock or a fast-forward gives the same result */
+    void TimeElapse (State* state, double deltaTime) {
+        if (state == nullptr || state->status != Status::WAIT_FOR_TIME) { return; }
+
+        state->waitTime -= deltaTime;
+        if (state->waitTime <= 0) {
+            state->waitTime = 0;
+            state->saveData.push_back("t");
+            state->status = Status::INTERPRET;
+        }
+    }
+    
     void AccentIncrement (State* state) {
         if (state == nullptr) { return; }
         
@@ -1551,7 +2639,7 @@ namespace dial {
     
     bool HasOneUseChoiceRecurred (State* state, int choice_i) {
         if (state == nullptr) { return false; }
-        return state->hasOneUseChoiceRecurred[state->choices[choice_i].jumpPos.text_i];
+        return IsCounterFlagSet(state, state->choices[choice_i].counter_i);
     }
     
     u32 GetChoicesSize (State* state) {
@@ -1559,113 +2647,692 @@ namespace dial {
         return state->choices.size();
     }
     
-    State* State_I (string file_n) {
-        State* state = new State();
-        
+    Script* Script_I (string file_n) { /* maps the file read-only, so every process playing it shares the page cache */
         string fullFile_n = file_n + ".dial";
-
-        FILE* textFile = fopen(fullFile_n.c_str(), "rb");
-        if (textFile != nullptr) {
-            fseek(textFile, 0, SEEK_END);
-            state->text_s = ftell(textFile);
-            fseek(textFile, 0, SEEK_SET);
-            
-            if (state->text_s < 2) {
-                Error("File with the following name doesn't have at least 2 characters: " + fullFile_n);
-                fclose(textFile);
-                delete state;
-                state = nullptr;
-                return state;
+        Script* script = new Script();
+        script->file_n = file_n;
+        script->ref_c = 1;
+        script->newer = nullptr;
+
+        #ifdef _WIN32
+        HANDLE fileHandle = CreateFileA(fullFile_n.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE) {
+            Error("Could not open a file with the following name: " + fullFile_n);
+            delete script;
+            return nullptr;
+        }
+        LARGE_INTEGER fileSize; GetFileSizeEx(fileHandle, &fileSize);
+        SYSTEM_INFO systemInfo; GetSystemInfo(&systemInfo);
+        script->text_s = (u32)fileSize.QuadPart;
+        if (AreScriptsMapped && script->text_s >= 2 && script->text_s % systemInfo.dwPageSize != 0) { /* the rest of the last page is zeroed, which terminates the text */
+            HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            void* mapping = (mappingHandle != nullptr) ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (mapping != nullptr) {
+                script->mapping = mapping;
+                script->mapping_s = script->text_s;
+                script->mappingHandle = mappingHandle;
+                script->fileHandle = fileHandle;
+                script->text = (const char*)mapping;
+            }
+            elif (mappingHandle != nullptr) {
+                CloseHandle(mappingHandle);
+            }
+        }
+        if (script->mapping == nullptr) {
+            CloseHandle(fileHandle);
+        }
+        #else
+        int fileDescriptor = open(fullFile_n.c_str(), O_RDONLY);
+        if (fileDescriptor < 0) {
+            Error("Could not open a file with the following name: " + fullFile_n);
+            delete script;
+            return nullptr;
+        }
+        struct stat fileStat; fstat(fileDescriptor, &fileStat);
+        script->text_s = (u32)fileStat.st_size;
+        if (AreScriptsMapped && script->text_s >= 2 && script->text_s % sysconf(_SC_PAGESIZE) != 0) { /* the rest of the last page is zeroed, which terminates the text */
+            void* mapping = mmap(nullptr, script->text_s, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+            if (mapping != MAP_FAILED) {
+                script->mapping = mapping;
+                script->mapping_s = script->text_s;
+                script->text = (const char*)mapping;
             }
-            
-            state->saveData.push_back("f:" + file_n);
+        }
+        close(fileDescriptor);
+        #endif
 
-            state->text = new char[state->text_s + 1];
-            fread(state->text, sizeof(char), state->text_s, textFile);
+        if (script->text_s < 2) {
+            Error("File with the following name doesn't have at least 2 characters: " + fullFile_n);
+            delete script;
+            return nullptr;
+        }
+        if (script->mapping == nullptr) { /* the file fills its last page exactly or couldn't be mapped, so it is read with a terminating 0 */
+            FILE* textFile = fopen(fullFile_n.c_str(), "rb");
+            if (textFile == nullptr) {
+                Error("Could not open a file with the following name: " + fullFile_n);
+                delete script;
+                return nullptr;
+            }
+            char* text = new char[script->text_s + 1];
+            script->text_s = fread(text, sizeof(char), script->text_s, textFile);
             fclose(textFile);
-            state->text[state->text_s] = 0;
-
-            /* "removing" comments */
-            bool isComment = false;
-            bool isInsideDoubleSlashComment = false;
-            u32 commentNestingDepth = 0;
-            char replaceSign = '\t';
-            for (u32 i = 0; i < state->text_s; i++) { /* @TODO check the logic here thoroughly */
-                if (state->text[i] == '/' && state->text[i + 1] == '*') {
-                    isComment = true;
-                    commentNestingDepth++;
-                    state->text[i] = replaceSign;
-                    state->text[i + 1] = replaceSign;
-                }
-                if (state->text[i] == '*' && state->text[i + 1] == '/') {
-                    commentNestingDepth--;
-                    if (commentNestingDepth == 0 && !isInsideDoubleSlashComment) {
-                        isComment = false;
-                    }
-                    state->text[i] = replaceSign;
-                    state->text[i + 1] = replaceSign;
-                }
-                if (state->text[i] == '/' && state->text[i + 1] == '/') {
-                    isInsideDoubleSlashComment = !isInsideDoubleSlashComment; 
-                    if (commentNestingDepth == 0 && !isInsideDoubleSlashComment) {
-                        isComment = false;
-                    }
-                    state->text[i] = replaceSign;
-                    state->text[i + 1] = replaceSign;
-                    i++;
-                }
+            text[script->text_s] = 0;
+            script->text = text;
+        }
+
+        if (!ScriptCompile(script)) {
+            Script_D(script);
+            return nullptr;
+        }
+        return script;
+    }
+
+    /* registers a script given in memory under the file name, so State_I plays it without reading the disk; the caller releases it with ScriptRelease */
+    Script* ScriptLoadText (string file_n, const string& text) {
+        if (text.length() < 2) {
+            Error("Text of the script with the following name doesn't have at least 2 characters: " + file_n);
+            return nullptr;
+        }
+        Script* script = new Script();
+        script->file_n = file_n;
+        script->ref_c = 1;
+        script->newer = nullptr;
+        script->text_s = text.length();
+        char* buffer = new char[script->text_s + 1];
+        memcpy(buffer, text.data(), script->text_s);
+        buffer[script->text_s] = 0;
+        script->text = buffer;
+
+        if (!ScriptCompile(script)) {
+            Script_D(script);
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(ScriptsMutex);
+        if (Scripts.count(file_n) != 0) {
+            Error("A script with the following name is already loaded: " + file_n);
+            Script_D(script);
+            return nullptr;
+        }
+        Scripts[file_n] = script; /* like ScriptAcquire, it stays registered while a reference is held */
+        return script;
+    }
+
+    bool ScriptCompile (Script* script) { /* indexes the text; false when the text shouldn't be executed */
+        LoadLineStarts(script);
+        LoadComments(script);
+
+        #ifdef DIAL_DEBUG
+        if (!AreScriptsLinted && HasDetectedCriticalErrors(script)) { return false; }
+        #endif
+
+        LoadJumpBases(script);
+        CompileInstrs(script);
+        LoadLinkedBases(script);
+        AssignCounterRange(script);
+        return true;
+    }
+
+    void AssignCounterRange (Script* script) { /* the counters of all scripts live in one index space, so the states' counter arrays work across chapters */
+        std::lock_guard<std::mutex> lock(CountersMutex);
+        auto it = CounterRanges.find(script->file_n);
+        if (it == CounterRanges.end() || it->second.second < script->counter_s) {
+            CounterRanges[script->file_n] = std::make_pair(Counter_s, script->counter_s);
+            Counter_s += script->counter_s;
+        }
+        script->counterBase = CounterRanges[script->file_n].first;
+        for (auto& instr : script->instrs) {
+            if (instr.second.counter_i >= 0) { instr.second.counter_i += script->counterBase; }
+        }
+        for (auto& choice : script->choiceCounters) {
+            choice.second += script->counterBase;
+        }
+    }
+
+    bool FileStamp (const string& path, long long& modified, long long& size) { /* the modification time and size, without opening the file */
+        #ifdef _WIN32
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes)) { return false; }
+        modified = ((long long)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+        size = ((long long)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+        #else
+        struct stat fileStat;
+        if (stat(path.c_str(), &fileStat) != 0) { return false; }
+        modified = (long long)fileStat.st_mtim.tv_sec * 1000000000 + fileStat.st_mtim.tv_nsec;
+        size = (long long)fileStat.st_size;
+        #endif
+        return true;
+    }
+
+    string BasesManifestPath (const string& file_n, string& name) { /* the manifest next to the file, and the file's name in it */
+        size_t separator_i = file_n.find_last_of("/\\");
+        if (separator_i == string::npos) {
+            name = file_n;
+            return DIAL_BASES_MANIFEST;
+        }
+        name = file_n.substr(separator_i + 1);
+        return file_n.substr(0, separator_i + 1) + DIAL_BASES_MANIFEST;
+    }
+
+    void BasesManifestRead (const string& manifest_n, map<string, LinkedFile>& manifest) { /* one line per file: "name modified size base base ..."; a damaged line only makes its file scanned again */
+        FILE* manifestFile = fopen(manifest_n.c_str(), "rb");
+        if (manifestFile == nullptr) { return; }
+        char line_b[4096];
+        string line;
+        while (fgets(line_b, sizeof(line_b), manifestFile) != nullptr) {
+            line += line_b;
+            if (line.back() != '\n' && !feof(manifestFile)) { continue; } /* a line longer than the buffer */
+            char* cursor = &line[0];
+            char* end = cursor;
+            while (*end != ' ' && *end != '\n' && *end != 0) { end++; }
+            string file_n(cursor, end - cursor);
+            LinkedFile linkedFile;
+            linkedFile.modified = strtoll(end, &cursor, 10);
+            linkedFile.size = strtoll(cursor, &end, 10);
+            bool isComplete = false;
+            while (true) {
+                while (*end == ' ') { end++; }
+                if (*end == ';') { isComplete = true; break; } /* every line ends with ';', a cut one is ignored */
+                unsigned long number = strtoul(end, &cursor, 10);
+                if (cursor == end) { break; }
+                linkedFile.bases.push_back((u32)number);
+                end = cursor;
+            }
+            if (isComplete && file_n != "") { manifest[file_n] = linkedFile; }
+            line.clear();
+        }
+        fclose(manifestFile);
+    }
+
+    void BasesManifestWrite (const string& manifest_n, const map<string, LinkedFile>& manifest) { /* written next to it and renamed over it, so a reader never sees half of it */
+        string temporary_n = manifest_n + ".tmp";
+        FILE* manifestFile = fopen(temporary_n.c_str(), "wb");
+        if (manifestFile == nullptr) { return; } /* a read-only directory only loses the speed-up */
+        for (auto& entry : manifest) {
+            fprintf(manifestFile, "%s %lld %lld", entry.first.c_str(), entry.second.modified, entry.second.size);
+            for (u32 number : entry.second.bases) { fprintf(manifestFile, " %u", number); }
+            fputs(" ;\n", manifestFile);
+        }
+        fclose(manifestFile);
+        #ifdef _WIN32
+        remove(manifest_n.c_str());
+        #endif
+        rename(temporary_n.c_str(), manifest_n.c_str());
+    }
+
+    void BasesManifestsFlush () { /* writes the manifests whose files were scanned, when the host allows it */
+        std::lock_guard<std::mutex> lock(BasesManifestMutex);
+        if (AreBasesManifestsWritten) {
+            for (const string& manifest_n : BasesManifestsChanged) { BasesManifestWrite(manifest_n, BasesManifests[manifest_n]); }
+        }
+        BasesManifestsChanged.clear();
+    }
+
+    bool LinkedFileBases (const string& file_n, vector<u32>& bases) { /* from the manifest while the file is unchanged, otherwise its "[[n" numbers are found with a plain scan */
+        std::lock_guard<std::mutex> lock(BasesManifestMutex);
+        string name;
+        string manifest_n = BasesManifestPath(file_n, name);
+        auto found = BasesManifests.find(manifest_n);
+        if (found == BasesManifests.end()) {
+            found = BasesManifests.emplace(manifest_n, map<string, LinkedFile>()).first;
+            BasesManifestRead(manifest_n, found->second);
+        }
+        map<string, LinkedFile>& manifest = found->second;
+        string fullFile_n = file_n + ".dial";
+        long long modified, size;
+        if (!FileStamp(fullFile_n, modified, size)) { return false; }
+        auto it = manifest.find(name);
+        if (it != manifest.end() && it->second.modified == modified && it->second.size == size) {
+            bases = it->second.bases;
+            return true;
+        }
+        FILE* textFile = fopen(fullFile_n.c_str(), "rb");
+        if (textFile == nullptr) { return false; }
+        string text_b;
+        char read_b[4096];
+        for (size_t read_s = fread(read_b, 1, sizeof(read_b), textFile); read_s != 0; read_s = fread(read_b, 1, sizeof(read_b), textFile)) {
+            text_b.append(read_b, read_s);
+        }
+        fclose(textFile);
+
+        bases.clear();
+        for (size_t t_i = text_b.find("[["); t_i != string::npos; t_i = text_b.find("[[", t_i + 2)) {
+            u32 number = 0;
+            size_t number_i = t_i + 2;
+            for (; number_i < text_b.size() && text_b[number_i] >= '0' && text_b[number_i] <= '9'; number_i++) {
+                number = number * 10 + (text_b[number_i] - '0');
+            }
+            if (number_i != t_i + 2) {
+                bases.push_back(number);
+            }
+        }
+        manifest[name] = {modified, size, bases};
+        BasesManifestsChanged.insert(manifest_n);
+        return true;
+    }
+
+    void LoadLinkedBases (Script* script) { /* the jump bases of the @INCLUDE@d files come from their DIAL_BASES_MANIFEST, nothing is compiled */
+        vector<u32> bases;
+        for (auto& instr : script->instrs) {
+            const vector<string>& segments = instr.second.segments;
+            if (script->text[instr.first] != '@' || segments.size() < 2 || StringToSpecCommand(segments[0]) != SPEC_INCLUDE) { continue; }
+
+            string file_n = segments[1];
+            if (!LinkedFileBases(file_n, bases)) {
+                Error("Could not open the included file with the following name: " + file_n + ".dial", script, instr.first);
+                continue;
+            }
+            for (u32 number : bases) {
+                if (script->jumpBasePos.count(number) == 0) { /* the script's own bases and the earlier includes win */
+                    script->linkedBases.emplace(number, file_n);
+                }
+            }
+        }
+        BasesManifestsFlush();
+    }
+
+    void Script_D (Script*& script) {
+        if (script == nullptr) { return; }
+
+        if (script->mapping != nullptr) {
+            #ifdef _WIN32
+            UnmapViewOfFile(script->mapping);
+            CloseHandle(script->mappingHandle);
+            CloseHandle(script->fileHandle);
+            #else
+            munmap(script->mapping, script->mapping_s);
+            #endif
+        }
+        else {
+            delete[] script->text;
+        }
+        delete script;
+        script = nullptr;
+    }
+
+    Script* ScriptAcquire (string file_n) { /* returns the already loaded script or loads it; every call has to be paired with ScriptRelease */
+        std::lock_guard<std::mutex> lock(ScriptsMutex);
+        auto it = Scripts.find(file_n);
+        if (it != Scripts.end()) {
+            it->second->ref_c++;
+            return it->second;
+        }
+        Script* script = Script_I(file_n);
+        if (script != nullptr) {
+            Scripts[file_n] = script;
+        }
+        return script;
+    }
+
+    void ScriptRetain (Script* script) { /* for a holder that already has a reference, e.g. a copied state */
+        if (script == nullptr) { return; }
+        script->ref_c++;
+    }
+
+    void ScriptRelease (Script*& script) {
+        if (script == nullptr) { return; }
+
+        std::lock_guard<std::mutex> lock(ScriptsMutex);
+        Script* released = script;
+        while (released != nullptr && --released->ref_c == 0) { /* a destroyed version releases its reloaded one */
+            auto it = Scripts.find(released->file_n);
+            if (it != Scripts.end() && it->second == released) {
+                Scripts.erase(it);
+            }
+            Script* newer = released->newer;
+            Script_D(released);
+            released = newer;
+        }
+        script = nullptr;
+    }
+
+    void ChapterTouch (Script* script) { /* marks the chapter as the most recently played one and evicts the coldest over the limit */
+        if (script == nullptr) { return; }
+
+        Script* evicted = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(ScriptsMutex);
+            auto it = std::find(ChapterCache.begin(), ChapterCache.end(), script);
+            if (it != ChapterCache.end()) {
+                ChapterCache.erase(it);
+            }
+            else {
+                script->ref_c++; /* the cache's own reference */
+            }
+            ChapterCache.insert(ChapterCache.begin(), script);
+            if (ChapterCache.size() > DIAL_CHAPTER_CACHE_SIZE) {
+                evicted = ChapterCache.back();
+                ChapterCache.pop_back();
+            }
+        }
+        ScriptRelease(evicted); /* freed unless a state still plays it */
+    }
+
+    Script* ChapterAcquire (string file_n) { /* ScriptAcquire for jumps, which keeps the recently played chapters loaded */
+        Script* script = ScriptAcquire(file_n);
+        ChapterTouch(script);
+        return script;
+    }
+
+    void ChapterCacheClear () {
+        vector<Script*> cache;
+        {
+            std::lock_guard<std::mutex> lock(ScriptsMutex);
+            cache.swap(ChapterCache);
+        }
+        for (Script* script : cache) {
+            ScriptRelease(script);
+        }
+    }
+
+    bool ScriptReload (string file_n) { /* publishes a new version of a loaded script; the states switch to it in HotReload */
+        {
+            std::lock_guard<std::mutex> lock(ScriptsMutex);
+            if (Scripts.find(file_n) == Scripts.end()) { return false; }
+        }
+        Script* fresh = Script_I(file_n); /* parsed outside of the lock, the states keep playing the old version meanwhile */
+        if (fresh == nullptr) { return false; }
+
+        std::lock_guard<std::mutex> lock(ScriptsMutex);
+        auto it = Scripts.find(file_n);
+        if (it == Scripts.end()) {
+            Script_D(fresh);
+            return false;
+        }
+        it->second->newer = fresh; /* the old version owns the reference fresh was created with */
+        it->second = fresh;
+        return true;
+    }
+
+    u32 RemapTextPos (Script* from, Script* to, u32 text_i) { /* the same line and column counted from the nearest preceding jump base both versions have */
+        u32 fromBase_i = 0;
+        u32 toBase_i = 0;
+        for (auto& base : from->jumpBasePos) {
+            u32 base_i = base.second.text_i;
+            if (base_i > text_i || base_i < fromBase_i) { continue; }
+            auto it = to->jumpBasePos.find(base.first);
+            if (it != to->jumpBasePos.end()) {
+                fromBase_i = base_i;
+                toBase_i = it->second.text_i;
+            }
+        }
+
+        u32 fromLine_i = GetLineIndex(from, text_i);
+        u32 line_c = fromLine_i - GetLineIndex(from, fromBase_i);
+        u32 column = text_i - std::max(from->lineStarts[fromLine_i], fromBase_i);
+
+        u32 toLine_i = GetLineIndex(to, toBase_i) + line_c;
+        if (toLine_i >= to->lineStarts.size()) { return to->text_s - 1; }
+        u32 t_i = (line_c == 0) ? toBase_i : to->lineStarts[toLine_i];
+        u32 lineEnd_i = (toLine_i + 1 < to->lineStarts.size()) ? to->lineStarts[toLine_i + 1] - 1 : to->text_s; /* a shortened line clamps to its '\n' */
+        return std::min(std::min(t_i + column, lineEnd_i), to->text_s - 1);
+    }
+
+    void RemapState (State* state, Script* from, Script* to) {
+        state->currentPos.text_i = RemapTextPos(from, to, state->currentPos.text_i);
+        for (u32 i = 0; i < state->jumpHistory.size(); i++) {
+            if (state->jumpHistory[i].file_n == from->file_n) {
+                Jump& jump = state->jumpHistory.Write(i);
+                jump.pos.text_i = RemapTextPos(from, to, jump.pos.text_i);
+            }
+        }
+        for (auto& choice : state->choices) {
+            choice.text_i = RemapTextPos(from, to, choice.text_i);
+            choice.jumpPos.text_i = RemapTextPos(from, to, choice.jumpPos.text_i);
+            auto counter = to->choiceCounters.find(choice.jumpPos.text_i);
+            choice.counter_i = (counter != to->choiceCounters.end()) ? counter->second : -1;
+        }
+
+        /* the counters move to the indices of the same conditionals and choices in the new version */
+        vector<int> condRepeat_c = *(state->condRepeat_c);
+        vector<bool> hasOneUseChoiceRecurred = *(state->hasOneUseChoiceRecurred);
+        condRepeat_c.resize(std::max((u32)condRepeat_c.size(), to->counterBase + to->counter_s), 0);
+        hasOneUseChoiceRecurred.resize(condRepeat_c.size(), false);
+        vector<std::pair<int,int>> moves; /* new index -> old index */
+        for (auto& instr : from->instrs) {
+            if (instr.second.counter_i < 0) { continue; }
+            auto it = to->instrs.find(RemapTextPos(from, to, instr.first));
+            if (it != to->instrs.end() && it->second.counter_i >= 0) { moves.push_back(std::make_pair(it->second.counter_i, instr.second.counter_i)); }
+        }
+        for (auto& choice : from->choiceCounters) {
+            auto it = to->choiceCounters.find(RemapTextPos(from, to, choice.first));
+            if (it != to->choiceCounters.end()) { moves.push_back(std::make_pair(it->second, choice.second)); }
+        }
+        vector<int> oldRepeat_c = condRepeat_c;
+        vector<bool> oldRecurred = hasOneUseChoiceRecurred;
+        for (u32 i = from->counterBase; i < from->counterBase + from->counter_s && i < condRepeat_c.size(); i++) {
+            condRepeat_c[i] = 0;
+            hasOneUseChoiceRecurred[i] = false;
+        }
+        for (auto& move : moves) {
+            if ((u32)move.second >= oldRepeat_c.size()) { continue; }
+            condRepeat_c[move.first] = oldRepeat_c[move.second];
+            hasOneUseChoiceRecurred[move.first] = oldRecurred[move.second];
+        }
+        state->condRepeat_c.Write() = condRepeat_c;
+        state->hasOneUseChoiceRecurred.Write() = hasOneUseChoiceRecurred;
+    }
 
-                if (isComment) {
-                    state->text[i] = replaceSign;
+    bool HotReload (State* state) { /* moves the state to the newest version of its script, keeping its place; called between the frames */
+        if (state == nullptr || state->script == nullptr || state->script->newer == nullptr) { return false; }
+
+        Script* script = state->script;
+        for (Script* newer = script->newer; newer != nullptr; newer = newer->newer) { /* positions are remapped version by version */
+            RemapState(state, script, newer);
+            script = newer;
+        }
+        ScriptRetain(script);
+        ScriptRelease(state->script);
+        state->script = script;
+        return true;
+    }
+
+    void WatcherLoop (Watcher* watcher) {
+        string prefix = (watcher->directory == ".") ? "" : watcher->directory + "/";
+        #ifdef __linux__
+        int inotifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyHandle < 0 || inotify_add_watch(inotifyHandle, watcher->directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            Error("Could not watch the following directory: " + watcher->directory);
+            if (inotifyHandle >= 0) { close(inotifyHandle); }
+            return;
+        }
+        alignas(struct inotify_event) char events_b[4096];
+        while (watcher->isRunning) {
+            struct pollfd pollHandle = {inotifyHandle, POLLIN, 0};
+            if (poll(&pollHandle, 1, 50) <= 0) { continue; } /* the timeout lets Watcher_D stop the thread */
+
+            set<string> changed; /* an editor's save can produce several events */
+            for (ssize_t events_s = read(inotifyHandle, events_b, sizeof(events_b)); events_s > 0; events_s = read(inotifyHandle, events_b, sizeof(events_b))) {
+                for (char* e = events_b; e < events_b + events_s; e += sizeof(struct inotify_event) + ((struct inotify_event*)e)->len) {
+                    struct inotify_event* event = (struct inotify_event*)e;
+                    string name = (event->len != 0) ? string(event->name) : "";
+                    if (name.length() > 5 && name.compare(name.length() - 5, 5, ".dial") == 0) {
+                        changed.insert(prefix + name.substr(0, name.length() - 5));
+                    }
                 }
             }
+            for (auto& file_n : changed) {
+                ScriptReload(file_n);
+            }
+        }
+        close(inotifyHandle);
+        #else
+        map<string, std::filesystem::file_time_type> writeTimes;
+        while (watcher->isRunning) { /* no change notifications here, so the loaded scripts' files are polled */
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            vector<string> loaded;
+            {
+                std::lock_guard<std::mutex> lock(ScriptsMutex);
+                for (auto& script : Scripts) { loaded.push_back(script.first); }
+            }
+            for (auto& file_n : loaded) {
+                if (file_n.compare(0, prefix.length(), prefix) != 0) { continue; }
+                std::error_code error;
+                auto writeTime = std::filesystem::last_write_time(file_n + ".dial", error);
+                if (error) { continue; }
+                auto it = writeTimes.find(file_n);
+                if (it != writeTimes.end() && it->second != writeTime) {
+                    ScriptReload(file_n);
+                }
+                writeTimes[file_n] = writeTime;
+            }
+        }
+        #endif
+    }
+
+    Watcher* Watcher_I (string directory) { /* should be created before the states, so that their scripts aren't mapped */
+        AreScriptsMapped = false;
+        Watcher* watcher = new Watcher();
+        watcher->directory = directory;
+        watcher->isRunning = true;
+        watcher->thread = std::thread(WatcherLoop, watcher);
+        return watcher;
+    }
+
+    void Watcher_D (Watcher*& watcher) {
+        if (watcher == nullptr) { return; }
+
+        watcher->isRunning = false;
+        watcher->thread.join();
+        delete watcher;
+        watcher = nullptr;
+    }
+
+    Arena* Arena_I (u32 buffer_s) {
+        Arena* arena = new Arena();
+        arena->buffer = new char[buffer_s];
+        arena->buffer_s = buffer_s;
+        arena->resetOverflow_c = 0;
+        arena->pass_c = 0;
+        arena->resource = new std::pmr::monotonic_buffer_resource(arena->buffer, buffer_s, &arena->upstream);
+        return arena;
+    }
+
+    void Arena_D (Arena*& arena) {
+        if (arena == nullptr) { return; }
+
+        delete arena->resource;
+        delete[] arena->buffer;
+        delete arena;
+        arena = nullptr;
+    }
+
+    Arena* ThreadArena () { /* one per thread, shared by every state interpreted on it; the temporaries of a pass are dead once the pass returns */
+        struct Holder {
+            Arena* arena = nullptr;
+            ~Holder () { Arena_D(arena); }
+        };
+        thread_local Holder holder;
+        if (holder.arena == nullptr) { holder.arena = Arena_I(); }
+        return holder.arena;
+    }
+
+    struct ArenaPass { /* marks a Dialogue_T pass, a pass started within another one (by a sink) mustn't release the outer one's temporaries */
+        Arena* arena;
+        ArenaPass (Arena* arena) : arena(arena) { arena->pass_c++; }
+        ~ArenaPass () { arena->pass_c--; }
+    };
+
+    void ArenaReset (Arena* arena) { /* frees everything allocated since the last reset; nothing allocated from the arena may be alive */
+        if (arena->pass_c > 1) { return; }
+        if (arena->upstream.overflow_c == arena->resetOverflow_c) {
+            arena->resource->release(); /* starts over from the buffer */
+            return;
+        }
+        u32 buffer_s = arena->buffer_s * 2; /* the last pass didn't fit, so the buffer grows until the passes do */
+        delete arena->resource;
+        delete[] arena->buffer;
+        arena->buffer = new char[buffer_s];
+        arena->buffer_s = buffer_s;
+        arena->resource = new std::pmr::monotonic_buffer_resource(arena->buffer, buffer_s, &arena->upstream);
+        arena->resetOverflow_c = arena->upstream.overflow_c;
+    }
+
+    Engine* Engine_I () {
+        Engine* engine = new Engine();
+        engine->isBacktrackLocked = false;
+        return engine;
+    }
+
+    void Engine_D (Engine*& engine) { /* the states using the engine have to be destroyed first */
+        if (engine == nullptr) { return; }
+
+        delete engine;
+        engine = nullptr;
+    }
+
+    State* State_I (string file_n, Engine* engine) {
+        State* state = new State();
+        state->engine = (engine != nullptr) ? engine : &DefaultEngine;
+        state->script = ScriptAcquire(file_n);
+        if (state->script != nullptr) {
+            state->saveData.push_back("f:" + file_n);
             
             state->textWidth = DIAL_DEFAULT_TEXT_WIDTH;
+            state->textSpeed = 0;
             state->displayText = "";
             state->status = Status::INTERPRET;
+            state->waitTime = 0;
+            state->isSpeculative = false;
+            #ifdef DIAL_QUIET
+            state->sink = NullSink();
+            #else
+            state->sink = ConsoleSink();
+            #endif
+            state->condCounter_i = -1;
+            state->condRepeat_c.Write().resize(state->script->counterBase + state->script->counter_s, 0);
+            state->hasOneUseChoiceRecurred.Write().resize(state->script->counterBase + state->script->counter_s, false);
 
             state->currentPos.text_i = 0;
             state->currentPos.condNestingDepth = 0;
             
-            state->seedRandom = time(0);
-            srand(state->seedRandom);
+            SeedRandom(state, time(0));
             state->saveData.push_back("s:" + std::to_string(state->seedRandom));
-
-            #ifdef DIAL_DEBUG
-            if (HasDetectedCriticalErrors(state)) {
-                State_D(state);  /* destroys and nulls the state as the text shouldn't be executed */
-                return state;
-            }
-            #endif
-
-            LoadJumpBases(state);
         }
         else {
-            Error("Could not open a file with the following name: " + fullFile_n);
             delete state;
             state = nullptr;
         }
         return state;
     };
 
+    State* StateCopy (State* state, Engine* engine) { /* forks a playthrough; the copy uses the given engine or shares the original's one */
+        if (state == nullptr) { return nullptr; }
+
+        State* copy = new State(*state);
+        copy->engine = (engine != nullptr) ? engine : state->engine;
+        ScriptRetain(copy->script);
+        if (state->possibleAccents.size() != 0) { /* the iterator has to point into the copy's own set */
+            copy->currentAccent = copy->possibleAccents.find(*(state->currentAccent));
+        }
+        return copy;
+    }
+
     void State_D (State*& state) { /* the & is here because the pointer is passed by reference, and thus can be nullptr'd */
         if (state == nullptr) { return; }
 
-        delete[] state->text;
+        ScriptRelease(state->script);
         delete state;
         state = nullptr;
     }
 
+    string StateSaveText (State* state) { /* what StateSave writes, StateLoadText replays it */
+        if (state == nullptr) { return ""; }
+
+        string text;
+        for (auto& data : state->saveData) {
+            text += data + ",";
+        }
+        return text;
+    }
+
     void StateSave (State* state, int save_i) {
         if (state == nullptr) { return; }
         
-        string file_n = "save_" + state->saveData[0].substr(2, state->saveData[1].length() - 8) + "_" + std::to_string(save_i) + ".txt"; /* @TODO .dial or .txt extension thing, change the magic numbers */
+        string file_n = "save_" + state->saveData[0].substr(2) + "_" + std::to_string(save_i) + ".txt"; /* "f:" comes before the script's name; @TODO .dial or .txt extension thing */
         
         FILE* textFile = fopen(file_n.c_str(), "w");
         if (textFile != nullptr) {
-            for (auto& data : state->saveData) {
-                fprintf(textFile, (data + ",").c_str());
-            }
+            fputs(StateSaveText(state).c_str(), textFile); /* a '%' in a saved variable isn't a format */
             fclose(textFile);
         }
         else {
@@ -1673,156 +3340,275 @@ namespace dial {
         }
     }
 
-    State* StateLoad (string file_n, int save_i) { /* @TODO */
-        State* state = nullptr;
-        
-        FILE* textFile = fopen(("save_" + file_n + "_" + std::to_string(save_i) + ".txt").c_str(), "rb");
-        if (textFile != nullptr) {
-            fseek(textFile, 0, SEEK_END);
-            u32 text_s = ftell(textFile);
-            fseek(textFile, 0, SEEK_SET);
-            
-            char* text = new char[text_s + 1];
-            fread(text, sizeof(char), text_s, textFile);
-            text[text_s] = 0;
-            
-            u32 text_i = 0;
-            
-            vector<string> saveData;
-            while (true) {
-                string saveDataText = "";
-                while (text_i != text_s) {
-                    if (text[text_i] == ',') {
-                        break;
+    /* replays the save data given in memory; save_n names it in the errors */
+    bool SeedTextRead (const string& data, u32& seed) { /* "s:" and the seed, which can exceed an int */
+        if (data.length() < 3 || data[1] != ':') { return false; }
+        char* seedEnd; seed = (u32)strtoul(data.c_str() + 2, &seedEnd, 10);
+        return *seedEnd == 0;
+    }
+
+    State* StateLoadText (const string& text, string save_n, Engine* engine) {
+        vector<string> saveData;
+        string saveDataText = "";
+        for (char c : text) { /* the entries end with ',', an unfinished last one is dropped */
+            if (c == ',') {
+                saveData.push_back(saveDataText);
+                saveDataText = "";
+            }
+            else {
+                saveDataText += c;
+            }
+        }
+        if (saveData.size() == 0 || saveData[0].length() < 3 || saveData[0][0] != 'f') {
+            Error("The file name is missing in a following save: " + save_n);
+            return nullptr;
+        }
+
+        State* state = State_I(saveData[0].substr(2, -1), engine);
+        if (state == nullptr) { return nullptr; }
+
+        u32 data_i = 1;
+        if (saveData.size() > 1 && saveData[1].length() != 0 && saveData[1][0] == 's') { /* reseeded before the first step, which may already draw RANDOM */
+            u32 seed;
+            if (!SeedTextRead(saveData[1], seed)) {
+                Error("Invalid seed while loading a following save: " + save_n);
+                State_D(state);
+                return state;
+            }
+            SeedRandom(state, seed);
+            state->saveData[1] = saveData[1]; /* saved again, it keeps the seed */
+            data_i = 2;
+        }
+
+        vector<string> vars;
+        for (; data_i < saveData.size(); data_i++) {
+            const string& data = saveData[data_i];
+            Dialogue_T(state);
+            if (data.length() == 0 || (string("fsav").find(data[0]) != string::npos && (data.length() < 2 || data[1] != ':'))) { /* these come with a "x:" prefix */
+                Error("Invalid data while loading a following save: " + save_n);
+                State_D(state);
+                return state;
+            }
+            switch (data[0]) {
+                case 'f': {
+                    break;
+                }
+                case 's': {
+                    u32 seed;
+                    if (!SeedTextRead(data, seed)) {
+                        Error("Invalid seed while loading a following save: " + save_n);
+                        State_D(state);
+                        return state;
                     }
-                    saveDataText += text[text_i];
-                    text_i++;
+                    SeedRandom(state, seed);
+                    break;
                 }
-                if (text_i == text_s) {
+                case 'a': {
+                    string accentText = data.substr(2, -1);
+                    auto accent = state->possibleAccents.find(accentText);
+                    if (accent != state->possibleAccents.end()) {
+                        state->currentAccent = state->possibleAccents.find(accentText);
+                    }
+                    else {
+                        Error("Invalid name of an accent while loading a following save: " + save_n);
+                        State_D(state);
+                        return state;
+                    }
+                    dial::RefreshAccentedChoices(state);
                     break;
                 }
-                if (text[text_i] == ',') {
-                    saveData.push_back(saveDataText);
-                    text_i++;
+                case 'v': {
+                    vars.push_back(data.substr(2, -1));
+                    break;
                 }
-            }
-            
-            state = State_I(saveData[0].substr(2, -1));
-            
-            vector<string> vars;
-            for (auto& data : saveData) {
-                Dialogue_T(state);
-                if (data.length() == 0) { 
-                    Error("Invalid data while loading a following file: " + string("save_") + file_n + "_" + std::to_string(save_i) + ".txt");
-                    delete state;
-                    state = nullptr;
-                    return state;
-                }
-                switch (data[0]) {
-                    case 'f': {
-                        break;
-                    }
-                    case 's': {
-                        state->seedRandom = std::stoul(data.substr(2, -1));
-                        srand(state->seedRandom);
-                        break;
+                case 't': { /* the wait has already passed, so it is fast-forwarded */
+                    TimeElapse(state, state->waitTime);
+                    break;
+                }
+                case '0': {
+                    for (auto& var : vars) {
+                        VarInstrInterpret(state, var);
                     }
-                    case 'a': {
-                        string accentText = data.substr(2, -1);
-                        auto accent = state->possibleAccents.find(accentText);
-                        if (accent != state->possibleAccents.end()) {
-                            state->currentAccent = state->possibleAccents.find(accentText);
+                    vars.clear();
+                    Continuation(state);
+                    break;
+                }
+                default: {
+                    bool hasSucceeded; int choiceNumber = stringToInt(data, hasSucceeded);
+                    if (hasSucceeded) {
+                        if (choiceNumber > 0) {
+                            if (state->status != Status::WAIT_FOR_CHOICE || choiceNumber > (int)state->choices.size()) { continue; }
+                            bool isValid = IsChoiceValid(state, choiceNumber - 1);
+                            if (!isValid) { continue; }
+                            Choice(state, choiceNumber - 1);
                         }
                         else {
-                            Error("Invalid name of an accent while loading a following file: " + string("save_") + file_n + "_" + std::to_string(save_i) + ".txt");
-                            delete state;
-                            state = nullptr;
+                            Error("Negative choice number while loading a following save: " + save_n);
+                            State_D(state);
                             return state;
                         }
-                        dial::RefreshAccentedChoices(state);
-                        break;
-                    }
-                    case 'v': {
-                        vars.push_back(data.substr(2, -1));
-                        break;
                     }
-                    case '0': {
-                        for (auto& var : vars) {
-                            VarInstrInterpret(state, var);
-                        }
-                        vars.clear();
-                        Continuation(state);
-                        break;
-                    }
-                    default: {
-                        bool hasSucceeded; int choiceNumber = stringToInt(data, hasSucceeded);
-                        if (hasSucceeded) {
-                            if (choiceNumber > 0) {
-                                bool isValid = IsChoiceValid(state, choiceNumber - 1);
-                                if (!isValid) { continue; }
-                                Choice(state, choiceNumber - 1);
-                            }
-                            else {
-                                Error("Negative choice number while loading a following file: " + string("save_") + file_n + "_" + std::to_string(save_i) + ".txt");
-                                delete state;
-                                state = nullptr;
-                                return state;
-                            }
-                        }
-                        else {
-                            Error("Couldn't recognize a symbol while loading a following file: " + string("save_") + file_n + "_" + std::to_string(save_i) + ".txt");
-                            delete state;
-                            state = nullptr;
-                            return state;
-                        }
-                        break;
+                    else {
+                        Error("Couldn't recognize a symbol while loading a following save: " + save_n);
+                        State_D(state);
+                        return state;
                     }
+                    break;
                 }
             }
-            for (auto& var : vars) {
-                VarInstrInterpret(state, var);
-            }
-            vars.clear();
-            Dialogue_T(state);
         }
-        else {
-            Error("Could not open a file with the following name: " + string("save_") + file_n + "_" + std::to_string(save_i) + ".txt");
+        for (auto& var : vars) {
+            VarInstrInterpret(state, var);
         }
+        vars.clear();
+        Dialogue_T(state);
         return state;
     }
-    
-    
-    
+
+    State* StateLoad (string file_n, int save_i, Engine* engine) {
+        string save_n = "save_" + file_n + "_" + std::to_string(save_i) + ".txt";
+        FILE* textFile = fopen(save_n.c_str(), "rb");
+        if (textFile == nullptr) {
+            Error("Could not open a file with the following name: " + save_n);
+            return nullptr;
+        }
+        string text;
+        char read_b[4096];
+        for (size_t read_s = fread(read_b, 1, sizeof(read_b), textFile); read_s != 0; read_s = fread(read_b, 1, sizeof(read_b), textFile)) {
+            text.append(read_b, read_s);
+        }
+        fclose(textFile);
+        return StateLoadText(text, save_n, engine);
+    }
+
+    bool IsPrefetchCurrent (Prefetch* prefetch, State* state) { /* whether the branches were forked from the state as it is now */
+        if (prefetch == nullptr || state == nullptr || prefetch->source != state) { return false; }
+        string accent = (state->possibleAccents.size() != 0) ? *(state->currentAccent) : "";
+        return prefetch->sourceScript == state->script && prefetch->sourcePos.text_i == state->currentPos.text_i
+            && prefetch->sourceSaveData_s == state->saveData.size() && prefetch->sourceAccent == accent
+            && (state->status == Status::WAIT_FOR_CHOICE || state->status == Status::WAIT_FOR_CONTINUATION);
+    }
+
+    void PrefetchLoop (Prefetch* prefetch) {
+        u32 branches_s = prefetch->branches.size();
+        for (u32 i = 0; i < branches_s; i++) { /* the main thread leaves the branches alone until isReady */
+            State* branch = prefetch->branches[i];
+            if (branch == nullptr) { continue; }
+            if (branch->status == Status::WAIT_FOR_CHOICE) {
+                Choice(branch, i); /* interprets up to the next wait */
+            }
+            else {
+                Continuation(branch);
+                Dialogue_T(branch);
+            }
+            if (prefetch->onBranchReady != nullptr) {
+                prefetch->onBranchReady(branch, prefetch->user);
+            }
+        }
+        prefetch->isReady = true;
+    }
+
+    Prefetch* Prefetch_I (State* state, void (*onBranchReady)(State* branch, void* user), void* user) { /* forks the state waiting for input, the forks play on with their own engines */
+        if (state == nullptr || (state->status != Status::WAIT_FOR_CHOICE && state->status != Status::WAIT_FOR_CONTINUATION)) { return nullptr; }
+
+        Prefetch* prefetch = new Prefetch();
+        prefetch->source = state;
+        prefetch->sourceScript = state->script;
+        prefetch->sourcePos = state->currentPos;
+        prefetch->sourceSaveData_s = state->saveData.size();
+        prefetch->sourceAccent = (state->possibleAccents.size() != 0) ? *(state->currentAccent) : "";
+        prefetch->onBranchReady = onBranchReady;
+        prefetch->user = user;
+        prefetch->isReady = false;
+
+        u32 branches_s = (state->status == Status::WAIT_FOR_CHOICE) ? state->choices.size() : 1;
+        for (u32 i = 0; i < branches_s; i++) {
+            if (state->status == Status::WAIT_FOR_CHOICE && !IsChoiceValid(state, i)) { /* an invalid choice can't be picked, so it gets no fork */
+                prefetch->branches.push_back(nullptr);
+                prefetch->engines.push_back(nullptr);
+                continue;
+            }
+            Engine* engine = new Engine(*(state->engine));
+            State* branch = StateCopy(state, engine);
+            branch->isSpeculative = true;
+            prefetch->branches.push_back(branch);
+            prefetch->engines.push_back(engine);
+        }
+
+        prefetch->thread = std::thread(PrefetchLoop, prefetch);
+        return prefetch;
+    }
+
+    /* replaces the state with the prefetched branch of the given choice (ignored for a continuation); false when it isn't ready or is out of date */
+    bool PrefetchAdopt (Prefetch* prefetch, State*& state, int choice_i) {
+        if (prefetch == nullptr || !prefetch->isReady || !IsPrefetchCurrent(prefetch, state)) { return false; }
+        u32 branch_i = (state->status == Status::WAIT_FOR_CHOICE) ? choice_i : 0;
+        if (branch_i >= prefetch->branches.size() || prefetch->branches[branch_i] == nullptr) { return false; }
+
+        State* branch = prefetch->branches[branch_i];
+        *(state->engine) = *(prefetch->engines[branch_i]); /* the branch's global variables become the real ones */
+        branch->engine = state->engine;
+        branch->isSpeculative = false;
+        ShowRefreshedText(branch);
+        prefetch->branches[branch_i] = nullptr;
+        State_D(state);
+        state = branch;
+        return true;
+    }
+
+    void Prefetch_D (Prefetch*& prefetch) { /* waits for the worker, the branches that weren't adopted are dropped */
+        if (prefetch == nullptr) { return; }
+
+        prefetch->thread.join();
+        for (u32 i = 0; i < prefetch->branches.size(); i++) {
+            State_D(prefetch->branches[i]);
+            Engine_D(prefetch->engines[i]);
+        }
+        delete prefetch;
+        prefetch = nullptr;
+    }
 
 
 
     void Dialogue_T (State* state) {
+        DIAL_PROF_SCOPE("Dialogue_T");
         if (state == nullptr) { return; }
-        char* txt = state->text;
+        const char* txt = state->script->text;
         u32& t_i = state->currentPos.text_i;
         int skipCond_c = 0;
         u32 jumpLoop_c = 0;
         bool hasActorNameOccured = false;
 
+        Arena* arena = ThreadArena();
+        ArenaPass pass(arena);
+
         Beginning:
         
+        ArenaReset(arena);
         SaveVarDiff(state);
         switch (state->status) {
             case Status::NONE: { break; }
-            case Status::WAIT_FOR_CONTINUATION: { break; }
-            case Status::WAIT_FOR_CHOICE: { break; }
-            case Status::INTERPRET: {
+            case Status::WAIT_FOR_CONTINUATION:
+            case Status::WAIT_FOR_CHOICE: {
             #ifdef DIAL_DEBUG
-                if (!isBacktrackLocked) {
-                    isBacktrackLocked = true;
+                if (!state->engine->isBacktrackLocked && ((int)state->flags & (int)Flags::NO_BACKTRACK) == 0) { /* the shown text or choices are snapshotted once */
+                    state->engine->isBacktrackLocked = true;
                     SaveBacktrackState(state);
                 }
+            #endif
+                break;
+            }
+            case Status::WAIT_FOR_TIME: { break; }
+            case Status::INTERPRET: {
+            #ifdef DIAL_DEBUG
+                state->engine->isBacktrackLocked = false;
             #endif
                 u32 persCond_s = state->persCond.size();
                 for (u32 i = 0; i < persCond_s; i++) {
                     bool isConditionTrue = CondInstrInterpret(state, state->persCond[i].second);
                     if (isConditionTrue) {
                         JumpPointInstrInterpret(state, state->persCond[i].first);
+                        txt = state->script->text; /* the jump may have switched to another chapter */
                         skipCond_c = 0;
                         state->persCond.erase(state->persCond.begin() + i);
                         break;
@@ -1832,31 +3618,42 @@ namespace dial {
                 while (true) {
                     switch (txt[t_i]) {
                         case '#': {
-                            string instrText = ScanTextUntil(txt, t_i, "#");
-                            VarInstrInterpret(state, instrText);
+                            Instr instr_b;
+                            const Instr& instr = GetInstr(state, t_i, instr_b);
+                            VarSegmentsInterpret(state, instr.segments, (instr.tokens.empty()) ? nullptr : &instr.tokens);
                             break;
                         }
                         case '@': {
-                            string instrText = ScanTextUntil(txt, t_i, "@");
-                            SpecInstrInterpret(state, instrText);
+                            Instr instr_b;
+                            const Instr& instr = GetInstr(state, t_i, instr_b);
+                            SpecSegmentsInterpret(state, instr.segments, (instr.tokens.empty()) ? nullptr : &instr.tokens);
+                            if (state->status == Status::WAIT_FOR_TIME) { /* @WAIT@ shows the text gathered so far and pauses the interpretation */
+                                if (IsTextVisible(state->displayText)) {
+                                    ShowText(state, state->displayText);
+                                }
+                                state->displayText = "";
+                                goto Beginning;
+                            }
                             break;
                         }
                         case '$': {
-                            string instrText = ScanTextUntil(txt, t_i, "$");
-                            PersCondInstrInterpret(state, instrText);
+                            Instr instr_b;
+                            PersCondInstrInterpret(state, GetInstr(state, t_i, instr_b).instrText);
                             break;
                         }
                         case '[': {
                             if (txt[t_i + 1] == '[') { /* [[...]], go past it */
-                                SeekEndOfStatement(txt, t_i, "]");
+                                SeekEndOfStatement(state->script, t_i, "]");
                             }
                             else { /* [...] */
-                                string instrText = ScanTextUntil(txt, t_i, "]");
+                                Instr instr_b;
+                                string instrText = GetInstr(state, t_i, instr_b).instrText; /* a copy, the jump may release the chapter holding it */
                                 JumpPointInstrInterpret(state, instrText);
+                                txt = state->script->text; /* the jump may have switched to another chapter */
                                 skipCond_c = 0;
                                 jumpLoop_c++;
                                 if (jumpLoop_c >= DIAL_JUMP_LOOP_LIMIT) {
-                                    Error("Infinite jump loop detected at jump point: " + instrText, txt, t_i);
+                                    Error("Infinite jump loop detected at jump point: " + instrText, state->script, t_i);
                                     state->status = Status::FATAL_ERROR;
                                     goto Beginning;
                                 }
@@ -1869,38 +3666,41 @@ namespace dial {
                         }
                         case '{': {
                             t_i++;
-                            SeekUntil(txt, t_i, "{}&");
+                            SeekUntil(state->script, t_i, "{}&");
 
                             if (txt[t_i] == '}') { /* {...} */
                                 t_i++;
-                                SeekEndOfChoiceRange(txt, t_i);
+                                SeekEndOfChoiceRange(state->script, t_i);
                             }
                             else { /* start of choice range */
-                                state->choices.clear();
+                                ChoicesClear(state);
                                 while (true) {
-                                    SeekUntil(txt, t_i, "{}&|");
+                                    SeekUntil(state->script, t_i, "{}&|");
 
                                     if (txt[t_i] == '{') { /* {... */
                                         u32 possibleBeginningOfChoice_i = t_i;
                                         t_i++;
-                                        SeekUntil(txt, t_i, "{}");
+                                        SeekUntil(state->script, t_i, "{}");
 
                                         if (txt[t_i] == '{') { /* {...{ */
-                                            SeekEndOfChoiceRange(txt, t_i); /* seek the end of this new nested choice range, so that we return to our original choice range */
+                                            SeekEndOfChoiceRange(state->script, t_i); /* seek the end of this new nested choice range, so that we return to our original choice range */
                                         }
                                         elif (txt[t_i] == '}') { /* {...} */
-                                            t_i = possibleBeginningOfChoice_i;
-                                            string choiceInstrText = ScanTextUntil(txt, t_i, "}");
+                                            t_i++;
+                                            u32 choiceText_i = possibleBeginningOfChoice_i + 1;
+                                            SkipWhitespace(state->script, choiceText_i);
 
-                                            if (choiceInstrText.length() != 0 && choiceInstrText[0] == '~' && state->hasOneUseChoiceRecurred[t_i]) { /* if a one-use choice has already been chosen, then it is hidden */
+                                            auto counter = state->script->choiceCounters.find(t_i);
+                                            int counter_i = (counter != state->script->choiceCounters.end()) ? counter->second : -1;
+                                            if (txt[choiceText_i] == '~' && IsCounterFlagSet(state, counter_i)) { /* if a one-use choice has already been chosen, then it is hidden */
                                                 continue;
                                             }
 
-                                            ChoiceObject choice_b;
-                                            choice_b.instrText = choiceInstrText;
-                                            choice_b.jumpPos.text_i = t_i;
-                                            choice_b.jumpPos.condNestingDepth = state->currentPos.condNestingDepth;
-                                            state->choices.push_back(choice_b);
+                                            ChoiceObject& choice = ChoiceAdd(state);
+                                            choice.text_i = possibleBeginningOfChoice_i;
+                                            choice.counter_i = counter_i;
+                                            choice.jumpPos.text_i = t_i;
+                                            choice.jumpPos.condNestingDepth = state->currentPos.condNestingDepth;
                                         }
                                     }
                                     elif (txt[t_i] == '}') { /* ...} */
@@ -1916,29 +3716,29 @@ namespace dial {
                                         goto Beginning;
                                     }
                                     elif (txt[t_i] == '&') { /* &...& */
-                                        if (IsItConditionalChoice(txt, t_i)) {
+                                        if (IsItConditionalChoice(state->script, t_i)) {
                                             while (txt[t_i] != '{') { /* loops the conditionals */
-                                                string instrText = ScanTextUntil(txt, t_i, "&");
-                                                bool isConditionTrue = CondInstrInterpret(state, instrText);
-                                                state->condRepeat_c[t_i]++;
+                                                Instr instr_b;
+                                                const Instr& instr = GetInstr(state, t_i, instr_b);
+                                                state->condCounter_i = instr.counter_i;
+                                                bool isConditionTrue = CompiledCondInterpret(state, instr);
+                                                CountConditional(state, instr.counter_i);
                                                 if (isConditionTrue) {
                                                     state->currentPos.condNestingDepth++;
                                                 }
                                                 else {
-                                                    SeekEndOfConditional(txt, t_i);
+                                                    SeekEndOfConditional(state->script, t_i);
                                                     break;
                                                 }
-                                                while (IsWhitespace(txt[t_i])) {
-                                                    t_i++;
-                                                }
+                                                SkipWhitespace(state->script, t_i);
                                             }
                                         }
                                         else {
-                                            SeekEndOfStatement(txt, t_i, "&");
-                                            SeekEndOfConditional(txt, t_i);
+                                            SeekEndOfStatement(state->script, t_i, "&");
+                                            SeekEndOfConditional(state->script, t_i);
                                         }
                                     }
-                                    elif (txt[t_i] == '|' && txt[t_i + 1] == '~') { /* |~ */
+                                    elif (txt[t_i] == '\0' || (txt[t_i] == '|' && txt[t_i + 1] == '~')) { /* |~ or the end of the text */
                                         Error("The conditional's corresponding '||' symbol is outside the choice range it's in or the choice range is missing the ending '}' symbol.");
                                         break;
                                     }
@@ -1947,7 +3747,7 @@ namespace dial {
                                         state->currentPos.condNestingDepth--;
 
                                         if (state->currentPos.condNestingDepth < 0) {
-                                            Error("Conditional nesting depth is below zero. There are stray '||' symbols or a corresponding conditional was not read properly.", txt, t_i);
+                                            Error("Conditional nesting depth is below zero. There are stray '||' symbols or a corresponding conditional was not read properly.", state->script, t_i);
                                             state->currentPos.condNestingDepth = 0;
                                         }
                                     }
@@ -1963,27 +3763,35 @@ namespace dial {
                             break;
                         }
                         case '&': {
-                            string instrText = ScanTextUntil(txt, t_i, "&");
-                            if (IsItConditionalChoice(txt, t_i)) {
-                                SeekEndOfChoiceRange(txt, t_i);
+                            Instr instr_b;
+                            const Instr& instr = GetInstr(state, t_i, instr_b);
+                            const string& instrText = instr.instrText;
+                            if (IsItConditionalChoice(state->script, t_i)) {
+                                SeekEndOfChoiceRange(state->script, t_i);
                             }
                             else {
-                                bool isConditionTrue = CondInstrInterpret(state, instrText);
-                                state->condRepeat_c[t_i]++;
+                                state->condCounter_i = instr.counter_i;
+                                bool isConditionTrue = CompiledCondInterpret(state, instr);
+                                CountConditional(state, instr.counter_i);
                                 if (isConditionTrue) {
                                     state->currentPos.condNestingDepth++;
                                     if (instrText.length() != 0 && instrText[0] == '~') {
                                         skipCond_c++;
                                     }
                                 }
+                                elif (instr.skip_i != 0) { /* found when compiling */
+                                    t_i = instr.skip_i;
+                                }
                                 else {
-                                    SeekEndOfConditional(txt, t_i);
+                                    SeekEndOfConditional(state->script, t_i);
                                 }
                             }
                             break;
                         }
+                        case '\0': /* the end of the text, the script is missing its |~ symbol */
                         case '|': {
-                            if (txt[t_i + 1] == '~') { /* |~ */
+                            if (txt[t_i] == '\0' || txt[t_i + 1] == '~') { /* |~ */
+                                if (txt[t_i] == '\0') { Error("The script ends without the '|~' symbol.", state->script, t_i); }
                                 if (IsTextVisible(state->displayText)) {
                                     ShowText(state, state->displayText);
                                 }
@@ -1996,7 +3804,7 @@ namespace dial {
                                 state->currentPos.condNestingDepth--;
 
                                 if (state->currentPos.condNestingDepth < 0) {
-                                    Error("Conditional nesting depth is below zero. There are stray '||' symbols or a corresponding conditional was not read properly.", txt, t_i);
+                                    Error("Conditional nesting depth is below zero. There are stray '||' symbols or a corresponding conditional was not read properly.", state->script, t_i);
                                     state->currentPos.condNestingDepth = 0;
                                 }
 
@@ -2021,6 +3829,17 @@ namespace dial {
                             }
                             break;
                         }
+                        case '/':
+                        case '*': {
+                            u32 commentEnd_i = CommentEnd(state->script, t_i);
+                            if (commentEnd_i != t_i) { /* a comment, it isn't a part of the text */
+                                t_i = commentEnd_i;
+                                break;
+                            }
+                            state->displayText += txt[t_i];
+                            t_i++;
+                            break;
+                        }
                         default: {
                             if (hasActorNameOccured == false && txt[t_i] == ':') {
                                 hasActorNameOccured = true;
@@ -2041,7 +3860,7 @@ namespace dial {
                 break;
             }
             case Status::FINISHED: {
-                std::cout<<"\n-END OF TRANSMISSION-\n"; /* @TODO remove? */
+                SinkNotify(state, SinkEvent::FINISHED);
 
                 state->status = Status::NONE;
                 break;
@@ -0,0 +1,491 @@
+/* branch-space explorer: walks every choice path of one .dial script and lists its reachable endings */
+/* build: g++ -std=c++17 -O2 -pthread explore.cpp -o dial-explore */
+/* usage: dial-explore <script name without .dial> [depth limit = 200] */
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <cmath>
+#include <vector>
+#include <array>
+#include <deque>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <memory_resource>
+#include <thread>
+#include <chrono>
+
+#define DIAL_QUIET
+#include "dial.hpp"
+
+#define u32 unsigned int
+#define u64 unsigned long long
+#define elif else if
+
+using std::string;
+using std::vector;
+
+namespace explore {
+    const u32 RANDOM_OUTCOMES = 100; /* RANDOM takes values from 1 to 100 */
+    const u32 VISITED_SHARDS = 64;
+    const u32 ENDING_BIT = 0x80000000; /* marks an edge's target as an ending's index instead of a state's */
+
+    struct Node { /* a playthrough waiting for the player, with its own copy of the global variables */
+        dial::State* state;
+        dial::Engine* engine;
+        u32 depth;
+        u32 id;        /* dense index of the state, 0 is the script's start */
+        double weight; /* probability of this outcome of the action that led here */
+    };
+
+    struct Ending {
+        u32 id;
+        u32 path_c = 0;   /* distinct states that finished with this text */
+        u32 minDepth = 0; /* fewest player inputs needed */
+        double probability = 0; /* of finishing here, for a player picking uniformly at random */
+    };
+
+    struct Edge { /* one outcome of an expanded state, the probabilities are summed over the states' graph once it is complete */
+        u32 from;
+        u32 to;
+        double probability;
+    };
+
+    void Node_D (Node& node) {
+        dial::State_D(node.state);
+        dial::Engine_D(node.engine);
+    }
+
+    Node NodeCopy (const Node& node) {
+        Node copy = node;
+        copy.engine = new dial::Engine(*node.engine);
+        copy.state = dial::StateCopy(node.state, copy.engine);
+        return copy;
+    }
+
+
+    /* hash of everything that decides how the script continues; converging branches get the same hash */
+    void HashBytes (u64& hash, const void* data, size_t data_s) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < data_s; i++) {
+            hash ^= bytes[i];
+            hash *= 0x100000001B3ULL; /* FNV-1a */
+        }
+    }
+    void HashString (u64& hash, const string& text) { u32 text_s = text.length(); HashBytes(hash, &text_s, sizeof(text_s)); HashBytes(hash, text.data(), text_s); }
+    void HashInt (u64& hash, int number) { HashBytes(hash, &number, sizeof(number)); }
+
+    bool IsPseudoVariable (const string& key) {
+        return (key == "REPEAT" || key == "ONCE" || key == "TRUE" || key == "FALSE" || key == "RANDOM");
+    }
+
+    struct RepeatReads { /* which conditionals read REPEAT or ONCE; how often the others ran can't change how the script continues */
+        std::mutex mutex;
+        std::set<string> scanned_n;
+        vector<char> isRead; /* by counter index, a counter of a script not scanned yet counts as read */
+    };
+    RepeatReads Repeats;
+
+    void RepeatReadsScan (const dial::Script* script) { /* called with the mutex locked */
+        if (!Repeats.scanned_n.insert(script->file_n).second) { return; }
+        u32 counter_e = script->counterBase + script->counter_s;
+        if (Repeats.isRead.size() < counter_e) { Repeats.isRead.resize(counter_e, 1); }
+        for (u32 i = script->counterBase; i < counter_e; i++) { Repeats.isRead[i] = 0; }
+        for (auto& instr : script->instrs) {
+            if (instr.second.counter_i < 0) { continue; }
+            for (const string& segment : instr.second.segments) {
+                if (segment.find("REPEAT") != string::npos || segment.find("ONCE") != string::npos) { Repeats.isRead[instr.second.counter_i] = 1; }
+            }
+        }
+    }
+
+    u64 StateHash (dial::State* state) {
+        u64 hash = 0xCBF29CE484222325ULL;
+        HashInt(hash, (int)state->status);
+        HashString(hash, state->script->file_n);
+        HashInt(hash, state->currentPos.text_i);
+        HashInt(hash, state->currentPos.condNestingDepth);
+        HashString(hash, state->displayText);
+        for (bool isElse : state->condElse) { HashInt(hash, isElse); }
+        HashInt(hash, -1);
+        for (auto& var : *(state->localVars)) { HashString(hash, var.first); HashInt(hash, var.second.first); HashString(hash, var.second.second); }
+        HashInt(hash, -1);
+        for (auto& var : *(state->engine->vars)) {
+            if (IsPseudoVariable(var.first)) { continue; }
+            HashString(hash, var.first); HashInt(hash, var.second.first); HashString(hash, var.second.second);
+        }
+        HashInt(hash, -1);
+        for (auto& cond : state->persCond) { HashString(hash, cond.first); HashString(hash, cond.second); }
+        HashInt(hash, -1);
+        const std::vector<bool>& hasOneUseChoiceRecurred = *(state->hasOneUseChoiceRecurred); /* set entries only, the arrays grow on demand */
+        for (u32 i = 0; i < hasOneUseChoiceRecurred.size(); i++) { if (hasOneUseChoiceRecurred[i]) { HashInt(hash, i); } }
+        HashInt(hash, -1);
+        const std::vector<int>& condRepeat_c = *(state->condRepeat_c);
+        {
+            std::lock_guard<std::mutex> lock(Repeats.mutex);
+            RepeatReadsScan(state->script);
+            for (u32 i = 0; i < condRepeat_c.size(); i++) {
+                if (condRepeat_c[i] != 0 && (i >= Repeats.isRead.size() || Repeats.isRead[i])) { HashInt(hash, i); HashInt(hash, condRepeat_c[i]); }
+            }
+        }
+        HashInt(hash, -1);
+        const dial::Chunked<dial::Jump>& jumpHistory = state->jumpHistory; /* only the jumps a return can reach: the latest one and the latest one to every base */
+        std::set<int> returnBases;
+        for (u32 i = jumpHistory.size(); i-- > 0;) {
+            const dial::Jump& jump = jumpHistory[i];
+            if (!returnBases.insert(jump.base_i).second) { continue; }
+            HashInt(hash, jump.base_i); HashInt(hash, jump.pos.text_i); HashInt(hash, jump.pos.condNestingDepth); HashString(hash, jump.file_n);
+        }
+        HashInt(hash, -1);
+        for (auto& choice : state->choices) { HashInt(hash, choice.jumpPos.text_i); }
+        return hash;
+    }
+
+
+    /* open-addressing map of 64-bit hashes to state ids, 12 bytes per visited state; split into shards to keep the locks short */
+    struct VisitedShard {
+        std::mutex mutex;
+        vector<u64> slots = vector<u64>(1024, 0);
+        vector<u32> ids = vector<u32>(1024, 0);
+        u64 used_c = 0;
+    };
+
+    u64 FindSlot (const vector<u64>& slots, u64 hash) { /* the slot holding the hash, or the empty one where it belongs */
+        u64 mask = slots.size() - 1;
+        u64 i = hash & mask;
+        while (slots[i] != hash && slots[i] != 0) { i = (i + 1) & mask; }
+        return i;
+    }
+
+    bool Visit (VisitedShard* shards, std::atomic<u32>& id_c, u64 hash, u32& id) { /* returns true if the state wasn't visited before, id is the state's either way */
+        if (hash == 0) { hash = 1; } /* 0 marks an empty slot */
+        VisitedShard& shard = shards[hash % VISITED_SHARDS];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if ((shard.used_c + 1) * 2 > shard.slots.size()) {
+            vector<u64> grown(shard.slots.size() * 2, 0);
+            vector<u32> grownIds(grown.size(), 0);
+            for (u64 i = 0; i < shard.slots.size(); i++) {
+                if (shard.slots[i] == 0) { continue; }
+                u64 slot_i = FindSlot(grown, shard.slots[i]);
+                grown[slot_i] = shard.slots[i];
+                grownIds[slot_i] = shard.ids[i];
+            }
+            shard.slots.swap(grown);
+            shard.ids.swap(grownIds);
+        }
+        u64 slot_i = FindSlot(shard.slots, hash);
+        if (shard.slots[slot_i] == hash) {
+            id = shard.ids[slot_i];
+            return false;
+        }
+        id = id_c++;
+        shard.slots[slot_i] = hash;
+        shard.ids[slot_i] = id;
+        shard.used_c++;
+        return true;
+    }
+
+
+    enum class Action { START, CONTINUE, TIME, CHOICE };
+
+    void Apply (Node& node, Action action, u32 accent_c, int choice_i) {
+        dial::State* state = node.state;
+        switch (action) {
+            case Action::START:    dial::Dialogue_T(state); break;
+            case Action::CONTINUE: dial::Continuation(state); dial::Dialogue_T(state); break;
+            case Action::TIME:     dial::TimeElapse(state, state->waitTime); dial::Dialogue_T(state); break;
+            case Action::CHOICE: {
+                if (state->possibleAccents.size() != 0) {
+                    state->currentAccent = state->possibleAccents.begin();
+                    for (u32 i = 0; i < accent_c; i++) { state->currentAccent++; }
+                }
+                dial::Choice(state, choice_i);
+                break;
+            }
+        }
+    }
+
+    /* runs the action; each RANDOM draw that isn't fixed by the tape yet splits the outcome 100 ways and identical results are merged with their weights added */
+    void Expand (const Node& node, Action action, u32 accent_c, int choice_i, vector<int>& tape, double weight, std::map<u64, Node>& results) {
+        Node child = NodeCopy(node);
+        child.state->randomTape = tape;
+        child.state->randomDraw_c = 0;
+        Apply(child, action, accent_c, choice_i);
+
+        if (child.state->randomDraw_c > tape.size()) {
+            Node_D(child);
+            for (u32 value = 1; value <= RANDOM_OUTCOMES; value++) {
+                tape.push_back(value);
+                Expand(node, action, accent_c, choice_i, tape, weight / RANDOM_OUTCOMES, results);
+                tape.pop_back();
+            }
+            return;
+        }
+        child.state->randomTape.clear();
+        child.weight = weight;
+        u64 hash = StateHash(child.state);
+        auto found = results.find(hash);
+        if (found != results.end()) {
+            found->second.weight += weight;
+            Node_D(child);
+        }
+        else {
+            results[hash] = child;
+        }
+    }
+
+
+    struct Explorer {
+        u32 depthLimit;
+        vector<std::deque<Node>> queues; /* one per thread; the owner works depth-first from the back, idle threads steal from the front */
+        vector<std::mutex*> queueMutexes;
+        std::atomic<long long> pending_c{0};
+        std::atomic<u64> expanded_c{0};
+        std::atomic<u64> merged_c{0};
+        std::atomic<u64> depthLimit_c{0};
+        std::atomic<u64> fatal_c{0};
+        std::atomic<u32> id_c{1}; /* 0 is the start */
+        VisitedShard visited[VISITED_SHARDS];
+        vector<vector<Edge>> edges; /* one list per thread */
+        std::mutex endingsMutex;
+        std::map<string, Ending> endings;
+        vector<Ending*> endingsById;
+    };
+
+    void Push (Explorer& explorer, u32 thread_i, Node node) {
+        explorer.pending_c++;
+        std::lock_guard<std::mutex> lock(*explorer.queueMutexes[thread_i]);
+        explorer.queues[thread_i].push_back(node);
+    }
+
+    bool Pop (Explorer& explorer, u32 thread_i, Node& node) {
+        u32 thread_s = explorer.queues.size();
+        for (u32 i = 0; i < thread_s; i++) {
+            u32 victim_i = (thread_i + i) % thread_s;
+            std::lock_guard<std::mutex> lock(*explorer.queueMutexes[victim_i]);
+            std::deque<Node>& queue = explorer.queues[victim_i];
+            if (queue.empty()) { continue; }
+            if (i == 0) { node = queue.back(); queue.pop_back(); }
+            else        { node = queue.front(); queue.pop_front(); }
+            return true;
+        }
+        return false;
+    }
+
+    string LastShownText (dial::State* state) {
+        for (auto it = state->textObjs->rbegin(); it != state->textObjs->rend(); it++) {
+            if (it->type == dial::TextType::NORMAL) {
+                string ending_n = it->text;
+                for (char& character : ending_n) { if (character == '\n') { character = ' '; } } /* undoes the wrapping */
+                return ending_n;
+            }
+        }
+        return "<no text>";
+    }
+
+    void Settle (Explorer& explorer, u32 thread_i, u32 parent_i, std::map<u64, Node>& results) { /* queues new states, records endings and drops the ones seen before */
+        for (auto& result : results) {
+            Node& child = result.second;
+            dial::Status status = child.state->status;
+            if (status == dial::Status::FINISHED || status == dial::Status::NONE || status == dial::Status::FATAL_ERROR) {
+                if (status == dial::Status::FATAL_ERROR) { explorer.fatal_c++; }
+                string ending_n = (status == dial::Status::FATAL_ERROR) ? "<fatal error>" : LastShownText(child.state);
+                std::lock_guard<std::mutex> lock(explorer.endingsMutex);
+                Ending& ending = explorer.endings[ending_n];
+                if (ending.path_c == 0) {
+                    ending.id = explorer.endingsById.size();
+                    explorer.endingsById.push_back(&ending);
+                }
+                if (ending.path_c == 0 || child.depth < ending.minDepth) { ending.minDepth = child.depth; }
+                ending.path_c++;
+                explorer.edges[thread_i].push_back({parent_i, ending.id | ENDING_BIT, child.weight});
+                Node_D(child);
+            }
+            elif (!Visit(explorer.visited, explorer.id_c, result.first, child.id)) {
+                explorer.merged_c++;
+                explorer.edges[thread_i].push_back({parent_i, child.id, child.weight}); /* its probability joins the state it converged with */
+                Node_D(child);
+            }
+            elif (child.depth >= explorer.depthLimit) {
+                explorer.depthLimit_c++;
+                explorer.edges[thread_i].push_back({parent_i, child.id, child.weight}); /* a state without edges keeps what reaches it */
+                Node_D(child);
+            }
+            else {
+                explorer.edges[thread_i].push_back({parent_i, child.id, child.weight});
+                Push(explorer, thread_i, child);
+            }
+        }
+    }
+
+    void Work (Explorer& explorer, u32 thread_i) {
+        Node node;
+        vector<int> tape;
+        while (explorer.pending_c.load() != 0) {
+            if (!Pop(explorer, thread_i, node)) {
+                std::this_thread::yield();
+                continue;
+            }
+            explorer.expanded_c++;
+            std::map<u64, Node> results;
+            dial::State* state = node.state;
+            Node next = node;
+            next.depth++;
+
+            if (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_CONTINUATION)) {
+                Expand(next, Action::CONTINUE, 0, 0, tape, 1.0, results);
+            }
+            elif (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_TIME)) {
+                Expand(next, Action::TIME, 0, 0, tape, 1.0, results);
+            }
+            elif (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_CHOICE)) {
+                u32 accent_s = std::max((u32)state->possibleAccents.size(), 1u);
+                u32 choices_s = dial::GetChoicesSize(state);
+                u32 option_c = 0; /* the player picks each valid choice under each accent equally often */
+                for (u32 accent_i = 0; accent_i < accent_s; accent_i++) {
+                    if (state->possibleAccents.size() != 0) {
+                        state->currentAccent = state->possibleAccents.begin();
+                        for (u32 i = 0; i < accent_i; i++) { state->currentAccent++; }
+                    }
+                    for (u32 choice_i = 0; choice_i < choices_s; choice_i++) {
+                        if (dial::IsChoiceValid(state, choice_i)) { option_c++; }
+                    }
+                }
+                for (u32 accent_i = 0; accent_i < accent_s; accent_i++) {
+                    if (state->possibleAccents.size() != 0) {
+                        state->currentAccent = state->possibleAccents.begin();
+                        for (u32 i = 0; i < accent_i; i++) { state->currentAccent++; }
+                    }
+                    for (u32 choice_i = 0; choice_i < choices_s; choice_i++) {
+                        if (!dial::IsChoiceValid(state, choice_i)) { continue; }
+                        std::map<u64, Node> choiceResults;
+                        Expand(next, Action::CHOICE, accent_i, choice_i, tape, 1.0 / option_c, choiceResults);
+                        for (auto& result : choiceResults) { /* choices leading to the same state add up */
+                            auto found = results.find(result.first);
+                            if (found != results.end()) {
+                                found->second.weight += result.second.weight;
+                                Node_D(result.second);
+                            }
+                            else { results[result.first] = result.second; }
+                        }
+                    }
+                }
+            }
+            Settle(explorer, thread_i, node.id, results);
+            Node_D(node);
+            explorer.pending_c--;
+        }
+    }
+
+    /* pushes the start's probability along the edges until it settles in the endings; a loop gives back less on every round */
+    double Propagate (Explorer& explorer) { /* returns what stayed in states cut at the depth limit */
+        u32 node_s = explorer.id_c;
+        vector<u32> edgeStarts(node_s + 1, 0); /* the edges of each state next to each other */
+        for (auto& edges : explorer.edges) { for (const Edge& edge : edges) { edgeStarts[edge.from + 1]++; } }
+        for (u32 i = 0; i < node_s; i++) { edgeStarts[i + 1] += edgeStarts[i]; }
+        vector<Edge> sorted(edgeStarts[node_s]);
+        vector<u32> fill_i(edgeStarts.begin(), edgeStarts.end() - 1);
+        for (auto& edges : explorer.edges) { for (const Edge& edge : edges) { sorted[fill_i[edge.from]++] = edge; } }
+
+        vector<double> pending(node_s, 0);
+        vector<bool> isQueued(node_s, false);
+        vector<u32> queue = {0};
+        pending[0] = 1.0;
+        isQueued[0] = true;
+        double cut = 0;
+        while (queue.size() != 0) {
+            u32 node_i = queue.back();
+            queue.pop_back();
+            isQueued[node_i] = false;
+            double probability = pending[node_i];
+            pending[node_i] = 0;
+            if (edgeStarts[node_i] == edgeStarts[node_i + 1]) {
+                cut += probability;
+                continue;
+            }
+            for (u32 i = edgeStarts[node_i]; i < edgeStarts[node_i + 1]; i++) {
+                const Edge& edge = sorted[i];
+                if (edge.to & ENDING_BIT) {
+                    explorer.endingsById[edge.to & ~ENDING_BIT]->probability += probability * edge.probability;
+                    continue;
+                }
+                pending[edge.to] += probability * edge.probability;
+                if (!isQueued[edge.to] && pending[edge.to] > 1e-12) { /* less than that is left in the loops */
+                    isQueued[edge.to] = true;
+                    queue.push_back(edge.to);
+                }
+            }
+        }
+        return cut;
+    }
+}
+
+int main (int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr<<"usage: "<<argv[0]<<" <script name without .dial> [depth limit]\n";
+        return 1;
+    }
+    string file_n = argv[1];
+
+    explore::Explorer explorer;
+    explorer.depthLimit = (argc > 2) ? (u32)std::stoul(argv[2]) : 200;
+
+    explore::Node root;
+    root.engine = dial::Engine_I();
+    root.state = dial::State_I(file_n, root.engine);
+    root.depth = 0;
+    root.id = 0;
+    root.weight = 1.0;
+    if (root.state == nullptr) {
+        std::cerr<<"Could not load the script: "<<file_n<<".dial\n";
+        dial::Engine_D(root.engine);
+        return 1;
+    }
+    dial::SeedRandom(root.state, 0);
+
+    u32 thread_s = std::max(1u, std::thread::hardware_concurrency());
+    explorer.queues.resize(thread_s);
+    explorer.edges.resize(thread_s);
+    for (u32 t = 0; t < thread_s; t++) { explorer.queueMutexes.push_back(new std::mutex()); }
+
+    auto timeStart = std::chrono::steady_clock::now();
+    {
+        std::map<u64, explore::Node> results;
+        vector<int> tape;
+        explore::Expand(root, explore::Action::START, 0, 0, tape, 1.0, results);
+        explore::Settle(explorer, 0, root.id, results);
+    }
+    vector<std::thread> threads;
+    for (u32 t = 0; t < thread_s; t++) {
+        threads.emplace_back(explore::Work, std::ref(explorer), t);
+    }
+    for (auto& thread : threads) { thread.join(); }
+    double cut = explore::Propagate(explorer);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+    std::cout<<"states expanded: "<<explorer.expanded_c<<", converged: "<<explorer.merged_c<<", cut at depth "<<explorer.depthLimit<<": "<<explorer.depthLimit_c
+             <<", fatal errors: "<<explorer.fatal_c<<'\n';
+    std::cout<<thread_s<<" threads, "<<std::fixed<<std::setprecision(3)<<seconds<<" s\n";
+    std::cout<<"\n-------ENDINGS------+ (probability for a player picking uniformly at random)\n";
+    double ended = 0;
+    for (auto& ending : explorer.endings) {
+        std::cout<<"  min. inputs "<<std::setw(4)<<ending.second.minDepth<<", states "<<std::setw(6)<<ending.second.path_c
+                 <<", probability "<<std::setprecision(4)<<ending.second.probability<<"  "<<ending.first<<'\n';
+        ended += ending.second.probability;
+    }
+    std::cout<<"  cut at the depth limit: "<<cut<<", looping without an end: "<<std::max(0.0, 1.0 - ended - cut)<<'\n';
+
+    explore::Node_D(root);
+    for (auto mutex : explorer.queueMutexes) { delete mutex; }
+    return 0;
+}
+
+#undef u32
+#undef u64
+#undef elif
@@ -14,9 +14,11 @@ namespace font {
                 uniform mat4 uProjection;
                 uniform mat4 uTransform;
                 uniform vec4 uColor;
+                uniform float uReveal;
 
                 layout (location = 0) in vec4 pos;
                 layout (location = 1) in vec2 vTexCoord;
+                layout (location = 2) in float vGlyph;
 
                 out vec4 fColor;
                 out vec2 fUV;
@@ -24,7 +26,7 @@ namespace font {
                 void main()
                 {
                     gl_Position = uProjection * uTransform * pos;
-                    fColor = uColor;
+                    fColor = vec4(uColor.rgb, uColor.a * clamp(uReveal - vGlyph, 0.0, 1.0)); /* glyphs past the reveal count stay transparent */
                     fUV = vTexCoord;
                 }
                 )";
@@ -0,0 +1,192 @@
+/* fuzz targets: a whole script played, one instruction evaluated, a save replayed; one of them is chosen at build time */
+/* build: clang++ -std=c++17 -g -O1 -fsanitize=fuzzer,address,undefined -DFUZZ_SCRIPT fuzz.cpp -o dial-fuzz-script */
+/*        the same with -DFUZZ_INSTRUCTION or -DFUZZ_SAVE, add -DDIAL_DEBUG to fuzz the checks of the debug build as well */
+/* build for AFL or for replaying a crash: add -DFUZZ_STANDALONE and drop "fuzzer,", then it runs the given files or the standard input */
+/* corpus: dial-fuzz-standalone --seed=corpus test unit writes seeds for its target from the scripts, the fuzzer then runs in the same directory */
+/* usage: dial-fuzz-script corpus -timeout=5, a hang is reported as a timeout */
+#include <stdlib.h>
+#include <stdint.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define DIAL_QUIET
+#include "dial.hpp"
+
+#define u32 unsigned int
+#define elif else if
+
+using std::string;
+using std::vector;
+
+#if !defined(FUZZ_SCRIPT) && !defined(FUZZ_INSTRUCTION) && !defined(FUZZ_SAVE)
+#define FUZZ_SCRIPT
+#endif
+
+namespace fuzz {
+    const u32 FUZZ_STEP_LIMIT = 64; /* steps played per input, a script looping forever isn't a bug of the interpreter */
+
+    void Play (dial::State* state, u32 step_s, u32 pick) { /* continues, picks choices spread by the pick and lets the waits pass */
+        for (u32 step_i = 0; step_i < step_s && state != nullptr; step_i++) {
+            dial::Dialogue_T(state);
+            if (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_CONTINUATION)) {
+                dial::Continuation(state);
+            }
+            elif (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_CHOICE)) {
+                u32 choices_s = dial::GetChoicesSize(state);
+                if (choices_s == 0) { return; }
+                if (step_i % 4 == 3) { dial::AccentIncrement(state); }
+                u32 choice_i = (pick + step_i) % choices_s;
+                if (!dial::IsChoiceValid(state, choice_i)) { continue; }
+                dial::Choice(state, choice_i);
+            }
+            elif (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_TIME)) {
+                dial::TimeElapse(state, state->waitTime);
+            }
+            elif (!dial::IsCurrentStatus(state, dial::Status::INTERPRET)) {
+                return;
+            }
+        }
+    }
+
+    u32 Pick (const uint8_t* data, size_t size) { /* the same input always takes the same path */
+        u32 pick = 2166136261u;
+        for (size_t i = 0; i < size; i++) { pick = (pick ^ data[i]) * 16777619u; }
+        return pick;
+    }
+
+    #ifdef FUZZ_SCRIPT
+    int FuzzOne (const uint8_t* data, size_t size) { /* the input is a script, it is played under its own name */
+        dial::Script* script = dial::ScriptLoadText("fuzz", string((const char*)data, size));
+        if (script == nullptr) { return 0; }
+        dial::Engine* engine = dial::Engine_I();
+        dial::State* state = dial::State_I("fuzz", engine);
+        dial::ScriptRelease(script);
+        dial::SeedRandom(state, 0);
+
+        Play(state, FUZZ_STEP_LIMIT, Pick(data, size));
+        dial::StateSaveText(state);
+
+        dial::State_D(state);
+        dial::Engine_D(engine);
+        dial::ChapterCacheClear(); /* the chapters it jumped to */
+        return 0;
+    }
+    #endif
+
+    #ifdef FUZZ_INSTRUCTION
+    int FuzzOne (const uint8_t* data, size_t size) { /* the input is the text between the delimiters of an instruction, tried as each kind */
+        static dial::Script* script = dial::ScriptLoadText("fuzz", "Text\n|~"); /* never released, the states only need something to play */
+        dial::Engine* engine = dial::Engine_I();
+        dial::State* state = dial::State_I("fuzz", engine);
+        dial::SeedRandom(state, 0);
+        string instrText((const char*)data, size);
+
+        dial::ArenaReset(dial::ThreadArena());
+        dial::OperationsInterpret(state, dial::SplitInstrSegments(instrText));
+        dial::ArenaReset(dial::ThreadArena());
+        dial::CondInstrInterpret(state, instrText);
+        dial::ArenaReset(dial::ThreadArena());
+        dial::VarInstrInterpret(state, instrText);
+        dial::SpecInstrInterpret(state, instrText);
+        dial::DisplayTextInterpret(instrText);
+
+        dial::State_D(state);
+        dial::Engine_D(engine);
+        (void)script;
+        return 0;
+    }
+    #endif
+
+    #ifdef FUZZ_SAVE
+    int FuzzOne (const uint8_t* data, size_t size) { /* the input is a save, its "f:" entry names a script of the working directory */
+        static dial::Script* scripts[] = {dial::ScriptAcquire("test"), dial::ScriptAcquire("unit")}; /* kept loaded, so an input doesn't parse them again */
+        dial::Engine* engine = dial::Engine_I();
+        dial::State* state = dial::StateLoadText(string((const char*)data, size), "fuzz", engine);
+
+        Play(state, 4, Pick(data, size));
+
+        dial::State_D(state);
+        dial::Engine_D(engine);
+        dial::ChapterCacheClear();
+        (void)scripts;
+        return 0;
+    }
+    #endif
+
+    #ifdef FUZZ_STANDALONE
+    bool SeedWrite (const string& directory, const string& name, const string& text) {
+        std::ofstream file(directory + "/" + name, std::ios::binary);
+        file<<text;
+        return file.good();
+    }
+
+    int SeedsWrite (const string& directory, const vector<string>& scripts) { /* the corpus the fuzzer starts from, derived from the scripts */
+        u32 seed_c = 0;
+        for (const string& script_n : scripts) {
+            std::ifstream file(script_n + ".dial", std::ios::binary);
+            if (!file) {
+                std::cerr<<"Could not open "<<script_n<<".dial\n";
+                return 1;
+            }
+            std::stringstream text;
+            text<<file.rdbuf();
+
+            #ifdef FUZZ_SCRIPT
+            seed_c += SeedWrite(directory, script_n, text.str());
+            #endif
+            #ifdef FUZZ_INSTRUCTION
+            dial::Script* script = dial::ScriptAcquire(script_n);
+            if (script == nullptr) { return 1; }
+            for (auto& instr : script->instrs) {
+                seed_c += SeedWrite(directory, script_n + "_" + std::to_string(instr.first), instr.second.instrText);
+            }
+            dial::ScriptRelease(script);
+            #endif
+            #ifdef FUZZ_SAVE
+            for (u32 step_s : {0u, 1u, 4u, 16u}) {
+                dial::State* state = dial::State_I(script_n);
+                dial::SeedRandom(state, step_s);
+                state->saveData[1] = "s:" + std::to_string(step_s);
+                Play(state, step_s, step_s);
+                seed_c += SeedWrite(directory, script_n + "_" + std::to_string(step_s), dial::StateSaveText(state));
+                dial::State_D(state);
+            }
+            #endif
+        }
+        std::cerr<<seed_c<<" seeds written to "<<directory<<"\n";
+        return 0;
+    }
+    #endif
+}
+
+#ifdef FUZZ_STANDALONE
+int main (int argc, char** argv) {
+    if (argc > 1 && strncmp(argv[1], "--seed=", 7) == 0) {
+        return fuzz::SeedsWrite(argv[1] + 7, vector<string>(argv + 2, argv + argc));
+    }
+    vector<string> inputs;
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        std::stringstream text;
+        text<<file.rdbuf();
+        inputs.push_back(text.str());
+    }
+    if (argc == 1) { /* AFL passes the input on the standard input */
+        std::stringstream text;
+        text<<std::cin.rdbuf();
+        inputs.push_back(text.str());
+    }
+    for (const string& input : inputs) {
+        fuzz::FuzzOne((const uint8_t*)input.data(), input.size());
+    }
+    return 0;
+}
+#else
+extern "C" int LLVMFuzzerTestOneInput (const uint8_t* data, size_t size) {
+    return fuzz::FuzzOne(data, size);
+}
+#endif
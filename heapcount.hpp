@@ -0,0 +1,65 @@
+#ifndef HEAPCOUNT_HPP
+#define HEAPCOUNT_HPP
+/* counts every heap allocation of the process by replacing the whole set of global operator new and delete */
+/* include it in exactly one translation unit of a program; bench.cpp and test.cpp read HeapAllocation_c around the measured code */
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include <cstddef>
+
+std::atomic<unsigned long long> HeapAllocation_c(0);
+
+void* HeapAllocate (size_t size, size_t alignment) {
+    HeapAllocation_c.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) { size = 1; }
+    if (alignment <= alignof(std::max_align_t)) { return malloc(size); }
+    #ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+    #else
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    #endif
+}
+
+[[gnu::noinline]] void HeapFree (void* p, size_t alignment) { /* not inlined, the compiler would see free() taking what operator new returned */
+    #ifdef _WIN32
+    if (alignment > alignof(std::max_align_t)) { _aligned_free(p); return; }
+    #endif
+    (void)alignment;
+    free(p);
+}
+
+void* operator new (size_t size) {
+    if (void* p = HeapAllocate(size, 0)) { return p; }
+    throw std::bad_alloc();
+}
+void* operator new[] (size_t size) {
+    if (void* p = HeapAllocate(size, 0)) { return p; }
+    throw std::bad_alloc();
+}
+void* operator new (size_t size, std::align_val_t alignment) {
+    if (void* p = HeapAllocate(size, (size_t)alignment)) { return p; }
+    throw std::bad_alloc();
+}
+void* operator new[] (size_t size, std::align_val_t alignment) {
+    if (void* p = HeapAllocate(size, (size_t)alignment)) { return p; }
+    throw std::bad_alloc();
+}
+void* operator new (size_t size, const std::nothrow_t&) noexcept { return HeapAllocate(size, 0); }
+void* operator new[] (size_t size, const std::nothrow_t&) noexcept { return HeapAllocate(size, 0); }
+void* operator new (size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return HeapAllocate(size, (size_t)alignment); }
+void* operator new[] (size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return HeapAllocate(size, (size_t)alignment); }
+
+void operator delete (void* p) noexcept { HeapFree(p, 0); }
+void operator delete[] (void* p) noexcept { HeapFree(p, 0); }
+void operator delete (void* p, size_t) noexcept { HeapFree(p, 0); }
+void operator delete[] (void* p, size_t) noexcept { HeapFree(p, 0); }
+void operator delete (void* p, const std::nothrow_t&) noexcept { HeapFree(p, 0); }
+void operator delete[] (void* p, const std::nothrow_t&) noexcept { HeapFree(p, 0); }
+void operator delete (void* p, std::align_val_t alignment) noexcept { HeapFree(p, (size_t)alignment); }
+void operator delete[] (void* p, std::align_val_t alignment) noexcept { HeapFree(p, (size_t)alignment); }
+void operator delete (void* p, size_t, std::align_val_t alignment) noexcept { HeapFree(p, (size_t)alignment); }
+void operator delete[] (void* p, size_t, std::align_val_t alignment) noexcept { HeapFree(p, (size_t)alignment); }
+void operator delete (void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept { HeapFree(p, (size_t)alignment); }
+void operator delete[] (void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept { HeapFree(p, (size_t)alignment); }
+
+#endif
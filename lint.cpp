@@ -0,0 +1,500 @@
+/* static checker: parses .dial scripts without playing them and reports what the interpreter would trip over */
+/* build: g++ -std=c++17 -O2 -pthread lint.cpp -o dial-lint */
+/* usage: dial-lint <script names without .dial or directories of scripts>..., run from the directory the game runs in */
+/* it exits with 1 when an error was found; a host shipping scripts that pass it can set dial::AreScriptsLinted */
+#include <stdlib.h>
+#include <iostream>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+
+#define DIAL_QUIET
+#include "dial.hpp"
+
+#define u32 unsigned int
+#define elif else if
+
+using std::string;
+using std::vector;
+using std::map;
+
+namespace lint {
+    const char* DIAL_BUILTIN_VARS[] = {"TRUE", "FALSE", "RANDOM", "REPEAT", "ONCE", "ELSE"}; /* set by the interpreter, never by a script */
+
+    enum class Severity {
+        ERROR,
+        WARNING
+    };
+
+    struct Finding {
+        u32 text_i;
+        Severity severity;
+        string message;
+    };
+
+    struct Target { /* the jump base a jump point leads to, in the chapter it is looked up in */
+        string file_n;
+        int base_i;
+        u32 text_i; /* of the jump point */
+    };
+
+    struct Report { /* what one script tells; the reports are checked against each other once all of them are parsed */
+        string file_n;
+        dial::Script* script;
+        vector<Finding> findings;
+        vector<Target> targets;
+        map<int, u32> bases;     /* jump base number -> position of its "[[" */
+        map<string, u32> reads;  /* variable -> its first read */
+        std::set<string> writes;
+    };
+
+    void Add (Report& report, u32 text_i, Severity severity, string message) {
+        report.findings.push_back({text_i, severity, message});
+    }
+
+    bool IsBuiltinVar (const string& name) {
+        for (const char* builtin : DIAL_BUILTIN_VARS) {
+            if (name == builtin) { return true; }
+        }
+        return false;
+    }
+
+    string VarName (string segment) { /* "!-Money" reads Money */
+        while (segment.length() != 0 && (segment[0] == '!' || segment[0] == '-')) { segment.erase(0, 1); }
+        return segment;
+    }
+
+    void ReadsAdd (Report& report, const vector<string>& segments, u32 segment_i, u32 text_i) { /* the variables among the operands from segment_i on */
+        for (; segment_i < segments.size(); segment_i++) {
+            if (dial::StringToOperator(segments[segment_i]) != dial::OP_NONE) { continue; }
+            if (!dial::OperandToken(segments[segment_i], segment_i).isVariable) { continue; }
+            string name = VarName(segments[segment_i]);
+            if (name.length() != 0 && !IsBuiltinVar(name)) { report.reads.emplace(name, text_i); }
+        }
+    }
+
+    bool StatementScan (Report& report, u32 t_i, u32& end_i, string& instrText) { /* the text between an instruction's symbols, which have to be on one line */
+        const char* txt = report.script->text;
+        char symbol = (txt[t_i] == '[') ? ']' : txt[t_i];
+        end_i = t_i + 1;
+        while (true) {
+            end_i = dial::CommentEnd(report.script, end_i);
+            if (txt[end_i] == symbol || txt[end_i] == '\n' || txt[end_i] == '\0') { break; }
+            end_i++;
+        }
+        if (txt[end_i] != symbol) {
+            Add(report, t_i, Severity::ERROR, string("The '") + txt[t_i] + "' instruction isn't closed with '" + symbol + "' on its line.");
+            return false;
+        }
+        dial::TextWithoutComments(report.script, t_i + 1, end_i, instrText);
+        if (instrText.length() != 0 && instrText[0] == '~') { instrText.erase(0, 1); }
+        end_i++;
+        return true;
+    }
+
+    void JumpCheck (Report& report, string jumpText, u32 t_i) { /* [5], [chapter2:5], [~] and [~5] as JumpPointInstrInterpret reads them */
+        dial::Script* script = report.script;
+        bool isReturn = (jumpText.length() != 0 && jumpText[0] == '~');
+        if (isReturn && jumpText.length() == 1) { return; }
+        if (isReturn) { jumpText.erase(0, 1); }
+
+        string file_n = "";
+        u32 fileSeparator_i = jumpText.find(':');
+        if (!isReturn && fileSeparator_i != (u32)string::npos) {
+            file_n = dial::RemoveWhitespace(jumpText.substr(0, fileSeparator_i));
+            jumpText = jumpText.substr(fileSeparator_i + 1);
+        }
+        bool hasSucceeded; int base_i = dial::stringToInt(jumpText, hasSucceeded);
+        if (!hasSucceeded) {
+            Add(report, t_i, Severity::ERROR, "The jump point's number can't be interpreted: " + jumpText);
+            return;
+        }
+
+        bool isLocal = (script->jumpBasePos.count(base_i) != 0);
+        bool isLinked = (script->linkedBases.count(base_i) != 0);
+        if (isReturn) { /* it returns to where the base was jumped to from, it doesn't lead to the base */
+            if (!isLocal && !isLinked) { Add(report, t_i, Severity::ERROR, "There's no jump base [[" + std::to_string(base_i) + "]] to return from."); }
+        }
+        elif (file_n != "" && file_n != report.file_n) {
+            report.targets.push_back({file_n, base_i, t_i});
+        }
+        elif (isLocal || file_n != "") {
+            report.targets.push_back({report.file_n, base_i, t_i});
+        }
+        elif (isLinked) {
+            report.targets.push_back({script->linkedBases.at(base_i), base_i, t_i});
+        }
+        else {
+            Add(report, t_i, Severity::ERROR, "There's no jump base [[" + std::to_string(base_i) + "]] in the script or in its included files.");
+        }
+    }
+
+    void VarInstrCheck (Report& report, const string& instrText, u32 t_i) {
+        vector<string> segments = dial::SplitInstrSegments(instrText);
+        if (segments.size() == 1) { /* Var, !Var, Var++ and Var-- */
+            string name = segments[0];
+            if (name.length() >= 2 && (name.compare(name.length() - 2, 2, "++") == 0 || name.compare(name.length() - 2, 2, "--") == 0)) { name.erase(name.length() - 2); }
+            report.writes.insert(VarName(name));
+        }
+        elif (segments.size() >= 3 && dial::StringToOperator(segments[1]) != dial::OP_NONE) {
+            report.writes.insert(segments[0]);
+            ReadsAdd(report, segments, 2, t_i);
+        }
+        else {
+            Add(report, t_i, Severity::ERROR, "The variable instruction has no assignment: " + instrText);
+        }
+    }
+
+    void SpecInstrCheck (Report& report, const string& instrText, u32 t_i) {
+        vector<string> segments = dial::SplitInstrSegments(instrText);
+        dial::SpecCommand command = dial::StringToSpecCommand(segments[0]);
+        if (command == dial::SPEC_NONE) {
+            Add(report, t_i, Severity::ERROR, "Unknown command in the special instruction: " + segments[0]);
+            return;
+        }
+        bool hasArgument = (command == dial::SPEC_SAVE || command == dial::SPEC_RESET || segments.size() >= 2);
+        if (!hasArgument) {
+            Add(report, t_i, Severity::ERROR, "The special instruction is missing its argument: " + instrText);
+            return;
+        }
+        bool hasSucceeded = true;
+        int number = (command == dial::SPEC_SPEED || command == dial::SPEC_WAIT) ? dial::stringToInt(segments[1], hasSucceeded) : 0;
+        if (!hasSucceeded || number < 0) {
+            Add(report, t_i, Severity::ERROR, "The special instruction's number can't be interpreted: " + segments[1]);
+        }
+        if (command == dial::SPEC_DISPLAY) {
+            ReadsAdd(report, segments, 1, t_i);
+        }
+        if (command == dial::SPEC_INCLUDE && !std::filesystem::exists(segments[1] + ".dial")) {
+            Add(report, t_i, Severity::ERROR, "The included file doesn't exist: " + segments[1] + ".dial");
+        }
+    }
+
+    void PersCondInstrCheck (Report& report, const string& instrText, u32 t_i) { /* $[5] Count < 5$ */
+        u32 open_i = instrText.find('[');
+        u32 close_i = (open_i != (u32)string::npos) ? instrText.find(']', open_i) : (u32)string::npos;
+        if (close_i == (u32)string::npos) {
+            Add(report, t_i, Severity::ERROR, "The persistent conditional has no [jump point]: " + instrText);
+            return;
+        }
+        JumpCheck(report, instrText.substr(open_i + 1, close_i - open_i - 1), t_i);
+        ReadsAdd(report, dial::SplitInstrSegments(instrText.substr(close_i + 1)), 0, t_i);
+    }
+
+    void ChoiceCheck (Report& report, u32 choice_i, u32 end_i) { /* the text between a choice's braces, its conditionals and its accents */
+        const char* txt = report.script->text;
+        string choiceText = "";
+        int condNestingDepth = 0;
+        for (u32 t_i = choice_i + 1; (t_i = dial::CommentEnd(report.script, t_i)) < end_i;) {
+            if (txt[t_i] == '&') {
+                u32 statementEnd_i; string instrText;
+                if (!StatementScan(report, t_i, statementEnd_i, instrText) || statementEnd_i > end_i) { return; }
+                ReadsAdd(report, dial::SplitInstrSegments(instrText), 0, t_i);
+                condNestingDepth++;
+                t_i = statementEnd_i;
+            }
+            elif (txt[t_i] == '|' && txt[t_i + 1] == '|') {
+                if (--condNestingDepth < 0) { Add(report, t_i, Severity::ERROR, "The '||' inside the choice closes no conditional."); condNestingDepth = 0; }
+                t_i += 2;
+            }
+            else {
+                choiceText += txt[t_i];
+                t_i++;
+            }
+        }
+        if (condNestingDepth > 0) { Add(report, choice_i, Severity::ERROR, "A conditional inside the choice isn't closed with '||'."); }
+
+        choiceText = dial::RemoveWhitespace(choiceText);
+        if (choiceText.length() != 0 && choiceText[0] == '~') { choiceText = dial::RemoveWhitespace(choiceText.substr(1)); }
+        if (choiceText.length() == 0 || choiceText[0] != '|') { return; }
+
+        u32 text_i = 1; /* |calm: Hello|angry: Go away */
+        u32 choiceText_s = choiceText.length();
+        while (text_i < choiceText_s) {
+            u32 name_i = text_i;
+            while (text_i < choiceText_s && choiceText[text_i] != ' ' && choiceText[text_i] != ':' && choiceText[text_i] != '|') { text_i++; }
+            string accentName = choiceText.substr(name_i, text_i - name_i);
+            while (text_i < choiceText_s && (choiceText[text_i] == ' ' || choiceText[text_i] == ':')) { text_i++; }
+            u32 accentedText_i = text_i;
+            while (text_i < choiceText_s && choiceText[text_i] != '|') { text_i++; }
+            string accentedText = dial::RemoveWhitespace(choiceText.substr(accentedText_i, text_i - accentedText_i));
+            text_i++;
+
+            if (accentName.length() == 0) {
+                Add(report, choice_i, Severity::ERROR, "The accented choice has an option without an accent's name.");
+            }
+            elif (std::isupper(accentName[0])) {
+                Add(report, choice_i, Severity::ERROR, "The accent '" + accentName + "' has to start with a lowercase letter, it is a local variable.");
+            }
+            else {
+                report.writes.insert(accentName);
+                if (accentedText.length() == 0) {
+                    Add(report, choice_i, Severity::WARNING, "The accent '" + accentName + "' has no choice text, the choice is empty when it is picked.");
+                }
+            }
+        }
+    }
+
+    void Parse (Report& report) { /* one pass over the text the way Dialogue_T reads it, with every scope on a stack */
+        const char* txt = report.script->text;
+        vector<std::pair<char,u32>> scopes; /* '&' of a conditional or '{' of a choice range, with its position */
+        u32 t_i = 0;
+        while (true) {
+            t_i = dial::CommentEnd(report.script, t_i);
+            switch (txt[t_i]) {
+                case '\0': {
+                    Add(report, t_i, Severity::ERROR, "The script ends without the '|~' symbol.");
+                    goto EndOfText;
+                }
+                case '#': case '@': case '$': case '&': {
+                    u32 end_i; string instrText;
+                    if (!StatementScan(report, t_i, end_i, instrText)) {
+                        t_i++;
+                        break;
+                    }
+                    if (txt[t_i] == '#')      { VarInstrCheck(report, instrText, t_i); }
+                    elif (txt[t_i] == '@')    { SpecInstrCheck(report, instrText, t_i); }
+                    elif (txt[t_i] == '$')    { PersCondInstrCheck(report, instrText, t_i); }
+                    else {
+                        vector<string> segments = dial::SplitInstrSegments(instrText);
+                        ReadsAdd(report, segments, (segments.size() != 0 && segments[0] == "ELSE") ? 1 : 0, t_i);
+                        scopes.push_back(std::make_pair('&', t_i));
+                    }
+                    t_i = end_i;
+                    break;
+                }
+                case '[': {
+                    if (txt[t_i + 1] == '[') { /* [[38]], [[7_the scene]] */
+                        u32 number_i = t_i + 2;
+                        u32 end_i = number_i;
+                        while (txt[end_i] != '\0' && strchr("-_ ]\n", txt[end_i]) == nullptr) { end_i++; }
+                        bool hasSucceeded; int base_i = dial::stringToInt(string(txt + number_i, end_i - number_i), hasSucceeded);
+                        if (!hasSucceeded) {
+                            Add(report, t_i, Severity::ERROR, "The jump base's number can't be interpreted: " + string(txt + number_i, end_i - number_i));
+                        }
+                        elif (report.bases.count(base_i) != 0) {
+                            Add(report, t_i, Severity::ERROR, "The jump base [[" + std::to_string(base_i) + "]] is defined again, the jumps lead to the last one.");
+                        }
+                        else {
+                            report.bases[base_i] = t_i;
+                        }
+                        while (txt[end_i] != '\0' && txt[end_i] != ']' && txt[end_i] != '\n') { end_i++; }
+                        if (txt[end_i] != ']' || txt[end_i + 1] != ']') {
+                            Add(report, t_i, Severity::ERROR, "The jump base isn't closed with ']]' on its line.");
+                        }
+                        while (txt[end_i] == ']') { end_i++; }
+                        t_i = end_i;
+                    }
+                    else {
+                        u32 end_i; string instrText;
+                        if (StatementScan(report, t_i, end_i, instrText)) {
+                            string jumpText; dial::TextWithoutComments(report.script, t_i + 1, end_i - 1, jumpText);
+                            JumpCheck(report, jumpText, t_i);
+                            t_i = end_i;
+                        }
+                        else {
+                            t_i++;
+                        }
+                    }
+                    break;
+                }
+                case '{': {
+                    u32 end_i = t_i + 1;
+                    dial::SeekUntil(report.script, end_i, "{}");
+                    if (txt[end_i] == '}') { /* {...} */
+                        ChoiceCheck(report, t_i, end_i);
+                        t_i = end_i + 1;
+                    }
+                    else {
+                        scopes.push_back(std::make_pair('{', t_i));
+                        t_i++;
+                    }
+                    break;
+                }
+                case '}': {
+                    auto scope = std::find_if(scopes.rbegin(), scopes.rend(), [](const std::pair<char,u32>& scope) { return scope.first == '{'; });
+                    if (scope == scopes.rend()) {
+                        Add(report, t_i, Severity::ERROR, "The '}' closes no choice range.");
+                    }
+                    else {
+                        for (auto it = scopes.rbegin(); it != scope; it++) { /* Dialogue_T would leave the range with these conditionals still open */
+                            Add(report, it->second, Severity::ERROR, "The conditional isn't closed with '||' before the end of its choice range.");
+                        }
+                        scopes.erase(std::next(scope).base(), scopes.end());
+                    }
+                    t_i++;
+                    break;
+                }
+                case ']': {
+                    Add(report, t_i, Severity::ERROR, "The ']' closes no jump point or jump base.");
+                    t_i++;
+                    break;
+                }
+                case '|': {
+                    if (txt[t_i + 1] == '~') { goto EndOfText; }
+                    if (txt[t_i + 1] == '|') { /* || */
+                        auto scope = std::find_if(scopes.rbegin(), scopes.rend(), [](const std::pair<char,u32>& scope) { return scope.first == '&'; });
+                        if (scope == scopes.rend()) {
+                            Add(report, t_i, Severity::ERROR, "The '||' closes no conditional.");
+                        }
+                        else {
+                            if (scope != scopes.rbegin()) {
+                                Add(report, t_i, Severity::ERROR, "The '||' closes the conditional at " + dial::GetCurrentTextFilePos(report.script, scope->second) + ", which is outside of the choice range it is in.");
+                            }
+                            scopes.erase(std::next(scope).base());
+                        }
+                        t_i += 2;
+                    }
+                    else {
+                        t_i++;
+                    }
+                    break;
+                }
+                default: t_i++; break;
+            }
+        }
+        EndOfText:
+
+        for (auto& scope : scopes) {
+            if (scope.first == '&') { Add(report, scope.second, Severity::ERROR, "The conditional isn't closed with '||'."); }
+            else                    { Add(report, scope.second, Severity::ERROR, "The choice range isn't closed with '}'."); }
+        }
+    }
+
+    void Lint (Report& report) {
+        report.script = dial::Script_I(report.file_n);
+        if (report.script == nullptr) {
+            Add(report, 0, Severity::ERROR, "The script can't be loaded.");
+            return;
+        }
+        Parse(report);
+    }
+
+    void CorpusCheck (vector<Report>& reports) { /* the jumps between the scripts and the variables they share */
+        map<string, dial::Script*> chapters; /* the scripts jumped to from the corpus but outside of it */
+        std::set<std::pair<string,int>> reached;
+        std::set<string> writes;
+        map<string, Report*> corpus;
+        for (Report& report : reports) {
+            corpus[report.file_n] = &report;
+            writes.insert(report.writes.begin(), report.writes.end());
+        }
+
+        for (Report& report : reports) {
+            for (Target& target : report.targets) {
+                dial::Script* chapter = nullptr;
+                if (corpus.count(target.file_n) != 0) {
+                    chapter = corpus[target.file_n]->script;
+                }
+                elif (chapters.count(target.file_n) != 0) {
+                    chapter = chapters[target.file_n];
+                }
+                else {
+                    chapter = chapters[target.file_n] = dial::Script_I(target.file_n);
+                }
+
+                if (chapter == nullptr) {
+                    Add(report, target.text_i, Severity::ERROR, "The chapter of the jump point can't be loaded: " + target.file_n + ".dial");
+                }
+                elif (chapter->jumpBasePos.count(target.base_i) == 0) {
+                    Add(report, target.text_i, Severity::ERROR, "There's no jump base [[" + std::to_string(target.base_i) + "]] in " + target.file_n + ".dial");
+                }
+                else {
+                    reached.insert(std::make_pair(target.file_n, target.base_i));
+                }
+            }
+        }
+
+        for (Report& report : reports) {
+            for (auto& base : report.bases) {
+                if (reached.count(std::make_pair(report.file_n, base.first)) == 0) {
+                    Add(report, base.second, Severity::WARNING, "No jump point in the checked scripts leads to the jump base [[" + std::to_string(base.first) + "]].");
+                }
+            }
+            for (auto& read : report.reads) {
+                if (writes.count(read.first) == 0) {
+                    Add(report, read.second, Severity::WARNING, "The variable '" + read.first + "' is read but never written.");
+                }
+            }
+        }
+        for (auto& chapter : chapters) { dial::Script_D(chapter.second); }
+    }
+
+    void ReportPrint (Report& report, u32& error_c, u32& warning_c) { /* file:line:col: kind: message, as compilers write them */
+        std::stable_sort(report.findings.begin(), report.findings.end(), [](const Finding& a, const Finding& b) { return a.text_i < b.text_i; });
+        for (Finding& finding : report.findings) {
+            std::cout<<report.file_n<<".dial";
+            if (report.script != nullptr) {
+                u32 line_i = dial::GetLineIndex(report.script, finding.text_i);
+                std::cout<<':'<<(line_i + 1)<<':'<<(finding.text_i - report.script->lineStarts[line_i] + 1);
+            }
+            std::cout<<((finding.severity == Severity::ERROR) ? ": error: " : ": warning: ")<<finding.message<<'\n';
+            if (finding.severity == Severity::ERROR) { error_c++; }
+            else                                     { warning_c++; }
+        }
+    }
+
+    vector<string> ScriptNames (int argc, char** argv) { /* a directory stands for every .dial file inside it */
+        vector<string> names;
+        for (int i = 1; i < argc; i++) {
+            std::filesystem::path path(argv[i]);
+            if (!std::filesystem::is_directory(path)) {
+                names.push_back(path.lexically_normal().generic_string());
+                continue;
+            }
+            vector<string> directoryNames;
+            for (auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".dial") {
+                    directoryNames.push_back((entry.path().parent_path() / entry.path().stem()).lexically_normal().generic_string()); /* the name a jump point would use */
+                }
+            }
+            std::sort(directoryNames.begin(), directoryNames.end());
+            names.insert(names.end(), directoryNames.begin(), directoryNames.end());
+        }
+        return names;
+    }
+}
+
+int main (int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr<<"usage: "<<argv[0]<<" <script names without .dial or directories of scripts>...\n";
+        return 1;
+    }
+    dial::AreScriptsLinted = true; /* the checks of the loader would reject the scripts whose errors are to be reported */
+    vector<string> names = lint::ScriptNames(argc, argv);
+    vector<lint::Report> reports(names.size());
+    for (u32 i = 0; i < names.size(); i++) { reports[i].file_n = names[i]; }
+
+    auto timeStart = std::chrono::steady_clock::now();
+    u32 thread_s = std::min(std::max(1u, std::thread::hardware_concurrency()), (u32)std::max((size_t)1, reports.size()));
+    std::atomic<u32> nextReport_i(0);
+    vector<std::thread> threads;
+    for (u32 t = 0; t < thread_s; t++) {
+        threads.emplace_back([&]() {
+            for (u32 report_i = nextReport_i++; report_i < reports.size(); report_i = nextReport_i++) {
+                lint::Lint(reports[report_i]);
+            }
+        });
+    }
+    for (auto& thread : threads) { thread.join(); }
+    lint::CorpusCheck(reports);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+    u32 error_c = 0;
+    u32 warning_c = 0;
+    for (lint::Report& report : reports) {
+        lint::ReportPrint(report, error_c, warning_c);
+        dial::Script_D(report.script);
+    }
+    std::cout<<reports.size()<<" scripts checked on "<<thread_s<<" threads in "<<(u32)(seconds * 1000)<<" ms: "
+             <<error_c<<" errors, "<<warning_c<<" warnings\n";
+    return (error_c != 0) ? 1 : 0;
+}
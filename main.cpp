@@ -22,7 +22,6 @@ std::array<GLfloat,16> PROJECTION;
 #include "text.hpp"
 #define DIAL_DEBUG
 #include "dial.hpp"
-#include "test.hpp"
 
 #define u32 unsigned int
 #define elif else if
@@ -54,6 +53,44 @@ bool IsKeyInState (GLFWwindow* window, int code, int desiredState) {
 }
 
 
+struct LayoutCache { /* glyph layouts of the prefetched texts, filled on the prefetch thread */
+    font::Font* font;
+    std::mutex mutex;
+    std::map<std::string, text::Layout> layouts;
+};
+
+void LayoutPrefetchedBranch (dial::State* branch, void* user) {
+    LayoutCache* cache = (LayoutCache*)user;
+    std::vector<std::string> strs = { branch->actor_n };
+    for (auto& textObj : *(branch->textObjs)) {
+        strs.push_back(textObj.text);
+    }
+    for (auto& str8 : strs) {
+        {
+            std::lock_guard<std::mutex> lock(cache->mutex);
+            if (cache->layouts.count(str8) != 0) { continue; }
+        }
+        text::Layout layout = text::LayoutBuild(cache->font, str8);
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        cache->layouts[str8] = std::move(layout);
+    }
+}
+
+void SinkAttach (dial::State* state, dial::RenderChanges* changes) { /* a new state is drawn from its first text object */
+    if (state == nullptr) { return; }
+    state->sink = dial::RendererSink(changes);
+    changes->isChanged = true;
+    changes->firstChanged_i = 0;
+}
+
+text::Text* TextFromCache (LayoutCache* cache, const std::string& str8) {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    auto it = cache->layouts.find(str8);
+    if (it != cache->layouts.end()) { return text::Text_I(cache->font, it->second); }
+    return text::Text_I(cache->font, str8);
+}
+
+
 void windowRefreshCallback (GLFWwindow *window) {
 }
 
@@ -69,16 +106,6 @@ void scrollCallback (GLFWwindow* window, double xoffset, double yoffset) {
 }
 
 int main () {
-    #ifdef TEST_HPP
-    test::givenUnformattedText_whenRemovedWhitespace_returnCleanText();
-    test::givenVariableInstruction_whenInstructionIsInterpreted_checkIfVariableChanged();
-    test::givenConditionInstruction_whenInstructionIsInterpreted_checkIfTrue();
-    test::givenCurrentStatus_whenCheckCurrentStatus_checkIfTrue();
-    test::givenTestFile_whenInterpreted_returnInterpretedText();
-    test::givenTestFile_whenInterpretedThenSavedAndLoaded_checkIfStateIsTheSameAsBefore();
-    #endif
-    
-    
     if (!glfwInit()) { return -1; }
 
     glfwWindowHint(GLFW_SAMPLES, 4);
@@ -107,9 +134,20 @@ int main () {
 
 
     font::Font* font = font::Font_I(28);
+#ifdef DIAL_DEBUG
+    dial::Watcher* watcher = dial::Watcher_I("."); /* edits to the scripts show up without restarting */
+#endif
     dial::State* state = dial::State_I("test");
+    dial::RenderChanges renderChanges = {}; /* what the interpreter changed since the meshes were built */
+    SinkAttach(state, &renderChanges);
+    dial::Prefetch* prefetch = nullptr; /* the next step computed while the player reads */
+    LayoutCache layoutCache;
+    layoutCache.font = font;
     
     std::vector<text::Text*> texts = {};
+    std::vector<std::string> textsSource = {}; /* texts the cached meshes were built from */
+    text::Text* actorNameText = nullptr;
+    std::string actorNameSource = "";
     
     while (!glfwWindowShouldClose(window)) {
         D_TIME = glfwGetTime();
@@ -117,12 +155,26 @@ int main () {
 
         if (!IS_PAUSED) {
             /* loop functions */
+#ifdef DIAL_DEBUG
+            dial::HotReload(state);
+#endif
             dial::Dialogue_T(state);
+            dial::TimeElapse(state, D_TIME);
+            if (!dial::IsPrefetchCurrent(prefetch, state)) {
+                dial::Prefetch_D(prefetch);
+                layoutCache.layouts.clear(); /* nothing writes to it with the worker joined */
+                prefetch = dial::Prefetch_I(state, LayoutPrefetchedBranch, &layoutCache);
+            }
 
             /* keyboard events */
             if (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_CONTINUATION)) {
                 if (IsKeyInState(window, GLFW_KEY_ENTER, GLFW_PRESS) || IsKeyInState(window, GLFW_KEY_SPACE, GLFW_PRESS)) {
-                    dial::Continuation(state);
+                    if (!texts.empty() && !text::IsRevealed(texts.back())) { /* the first press finishes the typewriter reveal */
+                        text::RevealAll(texts.back());
+                    }
+                    elif (!dial::PrefetchAdopt(prefetch, state, 0)) { /* the prefetched text shows in this frame */
+                        dial::Continuation(state);
+                    }
                 }
             }
             if (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_CHOICE)) {
@@ -138,7 +190,9 @@ int main () {
                     if (IsKeyInState(window, GLFW_KEY_1 + i, GLFW_RELEASE)) {
                         bool isValid = dial::IsChoiceValid(state, i);
                         if (!isValid) { continue; }
-                        dial::Choice(state, i);
+                        if (!dial::PrefetchAdopt(prefetch, state, i)) {
+                            dial::Choice(state, i);
+                        }
                         break;
                     }
                 }
@@ -150,26 +204,29 @@ int main () {
             }
             if (state != nullptr && (state->status == dial::Status::WAIT_FOR_CONTINUATION || state->status == dial::Status::WAIT_FOR_CHOICE)) {
                 if (IsKeyInState(window, GLFW_KEY_W, GLFW_PRESS) || IsKeyInState(window, GLFW_KEY_SPACE, GLFW_PRESS)) {
-                    system("cls");
+                    dial::Prefetch_D(prefetch);
                     dial::State_D(state);
                     state = dial::StateLoad("test", 0);
+                    SinkAttach(state, &renderChanges);
                 }
             }
 #ifdef DIAL_DEBUG
             if (IsKeyInState(window, GLFW_KEY_BACKSPACE, GLFW_PRESS)) { /* debug backtracking function */
                 dial::LoadBacktrackState(state);
+                SinkAttach(state, &renderChanges);
             }
             if (IsKeyInState(window, GLFW_KEY_D, GLFW_PRESS)) { /* debug information */
                 std::cout<<"\n--------------------+\n";
                 if (state != nullptr) {
-                    std::cout<<"Current position in file: "<<dial::GetCurrentTextFilePos(state->text, state->currentPos.text_i);
+                    std::cout<<"Current position in file: "<<dial::GetCurrentTextFilePos(state->script, state->currentPos.text_i);
                 }
                 dial::ShowVars(state);
             }
             if (IsKeyInState(window, GLFW_KEY_R, GLFW_PRESS)) { /* reset text module */
-                system("cls");
+                dial::Prefetch_D(prefetch);
                 dial::State_D(state);
                 state = dial::State_I("test");
+                SinkAttach(state, &renderChanges);
             }
 #endif
         }
@@ -190,21 +247,49 @@ int main () {
         
         
         if (state != nullptr) {
-            text::Text* actorNameText = text::Text_I(font, state->actor_n);
-            actorNameText->transform = lin::Translate(200, 0) * actorNameText->transform;
-            actorNameText->color = {0.6f, 0.0f, 0.0f, 1.0f}; 
+            if (actorNameText == nullptr || actorNameSource != state->actor_n) { /* meshes are only rebuilt when their text changes */
+                text::Text_D(actorNameText);
+                actorNameText = TextFromCache(&layoutCache, state->actor_n);
+                actorNameText->color = {0.6f, 0.0f, 0.0f, 1.0f}; 
+                actorNameSource = state->actor_n;
+            }
+            actorNameText->transform = lin::Translate(200, 0);
             text::Draw(actorNameText);
-            text::Text_D(actorNameText);
+
+            const dial::Chunked<dial::TextObject>& textObjs = state->textObjs;
+            u32 textObjs_s = textObjs.size();
+            if (renderChanges.isChanged) { /* only the text objects the interpreter reported are compared and rebuilt */
+                while (texts.size() > textObjs_s) {
+                    text::Text_D(texts.back());
+                    texts.pop_back();
+                    textsSource.pop_back();
+                }
+                for (u32 i = std::min(renderChanges.firstChanged_i, (u32)texts.size()); i < textObjs_s; i++) {
+                    if (i == texts.size()) {
+                        texts.push_back(nullptr);
+                        textsSource.push_back("");
+                    }
+                    if (texts[i] == nullptr || textsSource[i] != textObjs[i].text) {
+                        text::Text_D(texts[i]);
+                        texts[i] = TextFromCache(&layoutCache, textObjs[i].text);
+                        texts[i]->revealSpeed = (float)textObjs[i].revealSpeed;
+                        textsSource[i] = textObjs[i].text;
+                    }
+                }
+                renderChanges.isChanged = false;
+            }
+            for (auto text : texts) {
+                text::Reveal(text, D_TIME);
+            }
 
             int tY = 0;
             int tYmax = 0;
-            for (u32 i = 0; i < state->textObjs.size(); i++) { texts.push_back(text::Text_I(font, state->textObjs[i].text)); }
             for (auto it = texts.begin(); it != texts.end(); ++it) { 
                 tYmax += (*it)->lastCharPos.y - 28 - 10;
                 (*it)->color = {1.0f, 1.0f, 1.0f, 1.0f}; 
             }
             for (auto it = texts.begin(); it != texts.end(); ++it) { 
-                (*it)->transform = lin::Translate(-400, tY - tYmax -200) * (*it)->transform;
+                (*it)->transform = lin::Translate(-400, tY - tYmax -200);
                 tY += (*it)->lastCharPos.y - 28 - 10;
             }
             if (state != nullptr && state->status == dial::Status::WAIT_FOR_CHOICE) {
@@ -219,9 +304,7 @@ int main () {
             }
             for (auto text : texts) {
                 text::Draw(text);
-                text::Text_D(text);
             }
-            texts.clear();
         }
         
 
@@ -232,7 +315,19 @@ int main () {
     }
 
     /* deallocate */
+    for (auto text : texts) {
+        text::Text_D(text);
+    }
+    text::Text_D(actorNameText);
+    dial::Prefetch_D(prefetch);
     dial::State_D(state);
+#ifdef DIAL_DEBUG
+    dial::Watcher_D(watcher);
+#endif
+#ifdef DIAL_PROFILE
+    prof::SummaryPrint();
+    prof::TraceWrite("dial_trace.json");
+#endif
     font::Font_D(font);
 
     glfwTerminate(); 
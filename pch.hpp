@@ -10,8 +10,13 @@
 #include <array>
 #include <map>
 #include <set>
-//#include <chrono>
-//#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <memory_resource>
+#include <thread>
+#include <chrono>
 
 //#define MA_ENABLE_ONLY_SPECIFIC_BACKENDS
 //#define MA_ENABLE_WASAPI
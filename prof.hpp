@@ -0,0 +1,174 @@
+#ifndef PROF_HPP
+#define PROF_HPP
+/* instrumentation of the interpreter, compiled in with DIAL_PROFILE; without it dial.hpp's DIAL_PROF_ macros expand to nothing */
+/* every thread records into its own ring, the rings are read by TraceWrite and SummaryPrint once the interpreting threads are idle */
+
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <string>
+#include <map>
+#include <functional>
+
+#define u32 unsigned int
+#define elif else if
+
+namespace prof {
+    const u32 PROF_RING_SIZE = 1 << 16; /* events kept per thread, the oldest are overwritten */
+    const u32 PROF_STAT_SIZE = 64;      /* distinct names a thread can summarize, names beyond it are only in the ring */
+
+    typedef unsigned long long u64;
+
+    enum class EventType {
+        SCOPE,
+        COUNTER
+    };
+
+    struct Event {
+        const char* name; /* a string literal, compared by its address */
+        u64 start_ns;
+        u64 value;        /* duration of a scope, amount of a counter */
+        EventType type;
+    };
+
+    struct Stat { /* totals since the last reset, not limited by the ring */
+        const char* name;
+        EventType type;
+        u64 call_c;
+        u64 total;
+        u64 max;
+    };
+
+    struct Ring {
+        Event events[PROF_RING_SIZE];
+        Stat stats[PROF_STAT_SIZE];
+        std::atomic<u64> head; /* events written so far, published after each event */
+        u32 thread_i;
+        Ring* next;
+    };
+
+    std::atomic<Ring*> Rings(nullptr); /* the threads' rings, a thread pushes its own without a lock */
+    std::atomic<u32> Thread_c(0);
+    const std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+
+
+    u64 Now () { /* nanoseconds since the program started */
+        return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - StartTime).count();
+    }
+
+    Ring* ThreadRing () {
+        thread_local Ring* ring = nullptr;
+        if (ring == nullptr) { /* the ring outlives its thread, the export still reads it */
+            ring = new Ring();
+            ring->thread_i = Thread_c++;
+            ring->next = Rings.load();
+            while (!Rings.compare_exchange_weak(ring->next, ring)) {}
+        }
+        return ring;
+    }
+
+    void Record (const char* name, u64 start_ns, u64 value, EventType type) {
+        Ring* ring = ThreadRing();
+        u64 head = ring->head.load(std::memory_order_relaxed);
+        ring->events[head % PROF_RING_SIZE] = {name, start_ns, value, type};
+        ring->head.store(head + 1, std::memory_order_release);
+
+        u32 stat_i = (u32)(((size_t)name >> 3) % PROF_STAT_SIZE);
+        for (u32 i = 0; i < PROF_STAT_SIZE; i++) { /* open addressing by the name's address */
+            Stat& stat = ring->stats[(stat_i + i) % PROF_STAT_SIZE];
+            if (stat.name == nullptr) {
+                stat = {name, type, 0, 0, 0};
+            }
+            if (stat.name == name) {
+                stat.call_c++;
+                stat.total += value;
+                if (value > stat.max) { stat.max = value; }
+                return;
+            }
+        }
+    }
+
+    struct Scope { /* times the block it is declared in */
+        const char* name;
+        u64 start_ns;
+        Scope (const char* name) : name(name), start_ns(Now()) {}
+        ~Scope () { Record(name, start_ns, Now() - start_ns, EventType::SCOPE); }
+    };
+
+    void Count (const char* name, u64 value) {
+        Record(name, Now(), value, EventType::COUNTER);
+    }
+
+    void Reset () {
+        for (Ring* ring = Rings.load(); ring != nullptr; ring = ring->next) {
+            ring->head.store(0, std::memory_order_release);
+            std::memset(ring->stats, 0, sizeof(ring->stats));
+        }
+    }
+
+    bool TraceWrite (std::string file_n) { /* Chrome trace-event JSON, opened by chrome://tracing or Perfetto */
+        FILE* file = fopen(file_n.c_str(), "wb");
+        if (file == nullptr) { return false; }
+
+        fputs("{\"traceEvents\":[\n", file);
+        bool isFirst = true;
+        for (Ring* ring = Rings.load(); ring != nullptr; ring = ring->next) {
+            u64 head = ring->head.load(std::memory_order_acquire);
+            u64 event_i = (head > PROF_RING_SIZE) ? head - PROF_RING_SIZE : 0;
+            std::map<const char*, u64> counters; /* a counter event shows the running total of its thread */
+            for (; event_i < head; event_i++) {
+                const Event& event = ring->events[event_i % PROF_RING_SIZE];
+                fputs((isFirst) ? "" : ",\n", file);
+                isFirst = false;
+                if (event.type == EventType::SCOPE) {
+                    fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                            event.name, event.start_ns / 1000.0, event.value / 1000.0, ring->thread_i);
+                }
+                else {
+                    counters[event.name] += event.value;
+                    fprintf(file, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"value\":%llu}}",
+                            event.name, event.start_ns / 1000.0, ring->thread_i, counters[event.name]);
+                }
+            }
+        }
+        fputs("\n],\"displayTimeUnit\":\"ns\"}\n", file);
+        fclose(file);
+        return true;
+    }
+
+    void SummaryPrint (FILE* file = stdout) { /* one line per name over all threads, the slowest scope first */
+        std::map<std::string, Stat> totals;
+        for (Ring* ring = Rings.load(); ring != nullptr; ring = ring->next) {
+            for (const Stat& stat : ring->stats) {
+                if (stat.name == nullptr) { continue; }
+                Stat& total = totals[stat.name];
+                if (total.name == nullptr) { total = {stat.name, stat.type, 0, 0, 0}; }
+                total.call_c += stat.call_c;
+                total.total += stat.total;
+                if (stat.max > total.max) { total.max = stat.max; }
+            }
+        }
+
+        std::multimap<u64, const Stat*, std::greater<u64>> scopes;
+        for (auto& it : totals) {
+            if (it.second.type == EventType::SCOPE) { scopes.insert(std::make_pair(it.second.total, &it.second)); }
+        }
+        fprintf(file, "%-28s %12s %12s %12s %12s\n", "scope", "calls", "total ms", "mean us", "max us");
+        for (auto& it : scopes) {
+            const Stat& stat = *it.second;
+            fprintf(file, "%-28s %12llu %12.3f %12.3f %12.3f\n", stat.name, stat.call_c, stat.total / 1e6, stat.total / 1e3 / stat.call_c, stat.max / 1e3);
+        }
+        fprintf(file, "%-28s %12s %12s\n", "counter", "records", "total");
+        for (auto& it : totals) {
+            if (it.second.type == EventType::COUNTER) {
+                fprintf(file, "%-28s %12llu %12llu\n", it.second.name, it.second.call_c, it.second.total);
+            }
+        }
+    }
+}
+
+#undef u32
+#undef elif
+
+#endif /* prof.hpp */
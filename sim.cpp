@@ -0,0 +1,315 @@
+/* batch script simulator: plays one .dial script many times in parallel and reports its coverage */
+/* build: g++ -std=c++17 -O2 -pthread sim.cpp -o dial-sim */
+/* usage: dial-sim <script name without .dial> [runs = 10000] [random|exhaustive] [step limit = 10000] */
+/* exhaustive mode walks the tree of choices, accents and RANDOM values depth-first, runs is then the most runs it takes */
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <cmath>
+#include <vector>
+#include <array>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <memory_resource>
+#include <thread>
+#include <chrono>
+#include <random>
+
+#define DIAL_QUIET
+#include "dial.hpp"
+
+#define u32 unsigned int
+#define elif else if
+
+using std::string;
+using std::vector;
+
+namespace sim {
+    enum class Mode {
+        RANDOM,     /* picks a random valid choice and accent */
+        EXHAUSTIVE  /* every run replays a branch of the decision tree and takes the first option at each new decision */
+    };
+
+    const u32 RANDOM_OUTCOMES = 100;        /* RANDOM takes values from 1 to 100 */
+    const u32 RANDOM_TAPE_MARGIN = 1024;    /* draws a single step can make before they come from the state's generator */
+
+    struct Decision {
+        u32 value;      /* index of the option taken */
+        u32 option_c;
+        bool isRandom;  /* a RANDOM draw, fed to the state through its randomTape */
+    };
+
+    struct Walk { /* the decisions of one exhaustive run; those after prefix_s were met for the first time */
+        vector<Decision> path;
+        u32 prefix_s = 0;
+        u32 decision_i = 0;
+        u32 randomDraw_c = 0;
+    };
+
+    struct Branch { /* the decisions of a run up to depth, then the next untried option at that decision */
+        std::shared_ptr<const vector<Decision>> path; /* shared by the branches of one run */
+        u32 depth;
+        u32 value;
+    };
+
+    struct Frontier { /* the branches left to run, a stack so that the tree is walked depth-first */
+        vector<Branch> branches;
+        u32 running_c = 0;
+        u32 run_c = 0;
+        std::mutex mutex;
+        std::condition_variable isChanged;
+    };
+
+    u32 Decide (Walk& walk, bool isRandom, u32 option_c) { /* replays the path and then takes the first option */
+        if (option_c <= 1) { return 0; } /* nothing to branch on */
+        if (walk.decision_i < walk.path.size()) { return walk.path[walk.decision_i++].value; }
+        walk.path.push_back({0, option_c, isRandom});
+        walk.decision_i++;
+        return 0;
+    }
+
+    void DrawsRecord (Walk& walk, dial::State* state) { /* the draws the last step made are decisions too */
+        for (; walk.randomDraw_c < state->randomDraw_c; walk.randomDraw_c++) {
+            Decide(walk, true, RANDOM_OUTCOMES);
+        }
+        if (state->randomTape.size() < state->randomDraw_c + RANDOM_TAPE_MARGIN) { /* new draws take the first value */
+            state->randomTape.resize(state->randomDraw_c + RANDOM_TAPE_MARGIN, 1);
+        }
+    }
+
+    bool BranchTake (Frontier& frontier, u32 run_s, Walk& walk) { /* false when the tree is exhausted or the runs are used up */
+        std::unique_lock<std::mutex> lock(frontier.mutex);
+        frontier.isChanged.wait(lock, [&]() { return !frontier.branches.empty() || frontier.running_c == 0 || frontier.run_c >= run_s; });
+        if (frontier.branches.empty() || frontier.run_c >= run_s) { return false; }
+        Branch& branch = frontier.branches.back();
+        walk.path.assign(branch.path->begin(), branch.path->begin() + branch.depth);
+        bool hasSibling = false;
+        if (branch.depth < branch.path->size()) { /* only the first run's branch is empty */
+            walk.path.push_back((*branch.path)[branch.depth]);
+            walk.path.back().value = branch.value;
+            hasSibling = (branch.value + 1 < walk.path.back().option_c);
+        }
+        if (hasSibling) { branch.value++; } /* its next option stays on the stack */
+        else { frontier.branches.pop_back(); }
+        walk.prefix_s = walk.path.size();
+        walk.decision_i = 0;
+        walk.randomDraw_c = 0;
+        frontier.running_c++;
+        frontier.run_c++;
+        return true;
+    }
+
+    void BranchesAdd (Frontier& frontier, const Walk& walk) { /* the second options of the new decisions, the deepest is taken first */
+        auto path = std::make_shared<const vector<Decision>>(walk.path);
+        std::lock_guard<std::mutex> lock(frontier.mutex);
+        for (u32 i = walk.prefix_s; i < walk.path.size(); i++) {
+            frontier.branches.push_back({path, i, 1});
+        }
+        frontier.running_c--;
+        frontier.isChanged.notify_all();
+    }
+
+    unsigned long long UnexploredCount (const Frontier& frontier) { /* each untried option leads to at least one more run */
+        unsigned long long unexplored_c = 0;
+        for (auto& branch : frontier.branches) {
+            unexplored_c += (branch.depth < branch.path->size()) ? (*branch.path)[branch.depth].option_c - branch.value : 1;
+        }
+        return unexplored_c;
+    }
+
+    struct Stats {
+        std::map<std::pair<string,u32>, std::map<int, u32>> choiceVisit_c; /* choice range (script, position) -> choice number -> count */
+        std::map<std::pair<string,u32>, std::map<int, string>> choiceNames; /* choice range (script, position) -> choice number -> text */
+        std::map<int, u32>                jumpBaseVisit_c;
+        std::map<string, u32>             ending_c;      /* last shown text -> count */
+        u32 finished_c = 0;
+        u32 fatal_c = 0;
+        u32 stepLimit_c = 0;
+        u32 step_c = 0;
+    };
+
+    void Merge (Stats& into, const Stats& from) {
+        for (auto& range : from.choiceVisit_c) {
+            for (auto& choice : range.second) { into.choiceVisit_c[range.first][choice.first] += choice.second; }
+        }
+        for (auto& range : from.choiceNames) {
+            for (auto& choice : range.second) { into.choiceNames[range.first][choice.first] = choice.second; }
+        }
+        for (auto& base : from.jumpBaseVisit_c) { into.jumpBaseVisit_c[base.first] += base.second; }
+        for (auto& end : from.ending_c)         { into.ending_c[end.first] += end.second; }
+        into.finished_c += from.finished_c;
+        into.fatal_c += from.fatal_c;
+        into.stepLimit_c += from.stepLimit_c;
+        into.step_c += from.step_c;
+    }
+
+    string LastShownText (dial::State* state) {
+        for (auto it = state->textObjs->rbegin(); it != state->textObjs->rend(); it++) {
+            if (it->type == dial::TextType::NORMAL) { return it->text; }
+        }
+        return "<no text>";
+    }
+
+    void Run (string file_n, Mode mode, u32 stepLimit, std::mt19937& generator, Walk& walk, Stats& stats) {
+        dial::Engine* engine = dial::Engine_I(); /* every run has its own global variables */
+        dial::State* state = dial::State_I(file_n, engine);
+        if (state == nullptr) { stats.fatal_c++; dial::Engine_D(engine); return; }
+        dial::SeedRandom(state, generator());
+        if (mode == Mode::EXHAUSTIVE) {
+            for (auto& decision : walk.path) {
+                if (decision.isRandom) { state->randomTape.push_back(decision.value + 1); }
+            }
+            DrawsRecord(walk, state);
+        }
+
+        u32 step_i = 0;
+        for (; step_i < stepLimit; step_i++) {
+            dial::Dialogue_T(state);
+            if (mode == Mode::EXHAUSTIVE) { DrawsRecord(walk, state); }
+            if (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_CONTINUATION)) {
+                dial::Continuation(state);
+            }
+            elif (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_TIME)) {
+                dial::TimeElapse(state, state->waitTime);
+            }
+            elif (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_CHOICE)) {
+                if (state->possibleAccents.size() != 0) {
+                    u32 accent_c = (mode == Mode::RANDOM) ? generator() % state->possibleAccents.size() : Decide(walk, false, state->possibleAccents.size());
+                    for (u32 i = 0; i < accent_c; i++) { dial::AccentIncrement(state); }
+                }
+                vector<int> validChoices;
+                u32 choices_s = dial::GetChoicesSize(state);
+                for (u32 i = 0; i < choices_s; i++) {
+                    if (dial::IsChoiceValid(state, i)) { validChoices.push_back(i); }
+                }
+                if (validChoices.empty()) { stats.fatal_c++; break; }
+
+                u32 valid_i = (mode == Mode::RANDOM) ? generator() % validChoices.size() : Decide(walk, false, validChoices.size());
+
+                int choice_i = validChoices[valid_i];
+                std::pair<string,u32> range = {state->script->file_n, state->choices[0].jumpPos.text_i}; /* the first choice identifies the choice range, positions of different chapters can be equal */
+                stats.choiceVisit_c[range][choice_i]++;
+                stats.choiceNames[range][choice_i] = state->choices[choice_i].displayText;
+                dial::Choice(state, choice_i);
+            }
+            elif (dial::IsCurrentStatus(state, dial::Status::FINISHED)) {
+                continue;
+            }
+            elif (dial::IsCurrentStatus(state, dial::Status::NONE)) {
+                stats.finished_c++;
+                stats.ending_c[LastShownText(state)]++;
+                break;
+            }
+            elif (dial::IsCurrentStatus(state, dial::Status::FATAL_ERROR)) {
+                stats.fatal_c++;
+                break;
+            }
+        }
+        if (step_i == stepLimit) { stats.stepLimit_c++; }
+        stats.step_c += step_i;
+
+        std::set<int> visitedBases;
+        for (auto& jump : *(state->jumpHistory)) { visitedBases.insert(jump.base_i); }
+        for (int base : visitedBases) { stats.jumpBaseVisit_c[base]++; }
+        dial::State_D(state);
+        dial::Engine_D(engine);
+    }
+}
+
+int main (int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr<<"usage: "<<argv[0]<<" <script name without .dial> [runs] [random|exhaustive] [step limit]\n";
+        return 1;
+    }
+    string file_n    = argv[1];
+    u32 run_s        = (argc > 2) ? (u32)std::stoul(argv[2]) : 10000;
+    sim::Mode mode   = (argc > 3 && string(argv[3]) == "exhaustive") ? sim::Mode::EXHAUSTIVE : sim::Mode::RANDOM;
+    u32 stepLimit    = (argc > 4) ? (u32)std::stoul(argv[4]) : 10000;
+
+    dial::State* probe = dial::State_I(file_n); /* checks that the script loads and gets its jump bases */
+    if (probe == nullptr) {
+        std::cerr<<"Could not load the script: "<<file_n<<".dial\n";
+        return 1;
+    }
+
+    u32 thread_s = std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<u32> nextRun_i(0);
+    sim::Frontier frontier;
+    frontier.branches.push_back({std::make_shared<const vector<sim::Decision>>(), 0, 0}); /* the empty path is the first run */
+    std::mutex statsMutex;
+    sim::Stats total;
+
+    auto timeStart = std::chrono::steady_clock::now();
+    vector<std::thread> threads;
+    for (u32 t = 0; t < thread_s; t++) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 generator(0x5EED + t);
+            sim::Stats stats;
+            sim::Walk walk;
+            if (mode == sim::Mode::RANDOM) {
+                for (u32 run_i = nextRun_i++; run_i < run_s; run_i = nextRun_i++) {
+                    sim::Run(file_n, mode, stepLimit, generator, walk, stats);
+                }
+            }
+            else {
+                while (sim::BranchTake(frontier, run_s, walk)) {
+                    sim::Run(file_n, mode, stepLimit, generator, walk, stats);
+                    sim::BranchesAdd(frontier, walk);
+                }
+            }
+            std::lock_guard<std::mutex> lock(statsMutex);
+            sim::Merge(total, stats);
+        });
+    }
+    for (auto& thread : threads) { thread.join(); }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+    if (mode == sim::Mode::EXHAUSTIVE) { run_s = frontier.run_c; }
+    std::cout<<"runs: "<<run_s<<" on "<<thread_s<<" threads, "<<std::fixed<<std::setprecision(3)<<seconds<<" s, "
+             <<std::setprecision(0)<<(run_s / std::max(seconds, 1e-9))<<" runs/s, "<<total.step_c<<" steps\n";
+    std::cout<<"finished: "<<total.finished_c<<", fatal errors: "<<total.fatal_c<<", step limit reached: "<<total.stepLimit_c<<"\n";
+    if (mode == sim::Mode::EXHAUSTIVE && frontier.branches.empty()) {
+        std::cout<<"exhaustive: every branch was run"<<((total.stepLimit_c != 0) ? ", the ones reaching the step limit were cut there\n" : "\n");
+    }
+    elif (mode == sim::Mode::EXHAUSTIVE) {
+        std::cout<<"exhaustive: stopped at the run limit, at least "<<sim::UnexploredCount(frontier)<<" branches are left unexplored\n";
+    }
+
+    std::cout<<"\n-------CHOICES------+\n";
+    for (auto& range : total.choiceVisit_c) {
+        dial::Script* script = dial::ScriptAcquire(range.first.first); /* the range's own script, it may be a chapter */
+        std::cout<<"range "<<range.first.first<<" "<<((script != nullptr) ? dial::GetCurrentTextFilePos(script, range.first.second) : "")<<'\n';
+        dial::ScriptRelease(script);
+        for (auto& choice : range.second) {
+            std::cout<<std::setw(10)<<choice.second<<"  "<<dial::ChoiceNumberPrefix(choice.first)<<total.choiceNames[range.first][choice.first]<<'\n';
+        }
+    }
+
+    std::cout<<"\n-----JUMP BASES-----+\n";
+    for (auto& base : probe->script->jumpBasePos) {
+        if (total.jumpBaseVisit_c.count(base.first) != 0) {
+            std::cout<<std::setw(10)<<total.jumpBaseVisit_c[base.first]<<"  [["<<base.first<<"]]\n";
+        }
+        else {
+            std::cout<<"never jumped to [["<<base.first<<"]] "<<dial::GetCurrentTextFilePos(probe->script, base.second.text_i)<<'\n';
+        }
+    }
+
+    std::cout<<"\n-------ENDINGS------+\n";
+    for (auto& ending : total.ending_c) {
+        std::cout<<std::setw(10)<<ending.second<<"  "<<ending.first<<'\n';
+    }
+    dial::State_D(probe);
+    return 0;
+}
+
+#undef u32
+#undef elif
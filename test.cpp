@@ -0,0 +1,63 @@
+/* headless test runner: the interpreter's unit and script tests without a window, GL or GLFW */
+/* build: g++ -std=c++17 -O1 -pthread test.cpp -o dial-test */
+/* usage: dial-test [filter], run from the directory with test.dial and unit.dial; a failed test aborts at its assert */
+#undef NDEBUG
+
+#define DIAL_DEBUG
+#include "dial.hpp"
+#include "heapcount.hpp"
+#include "test.hpp"
+
+#define u32 unsigned int
+#define elif else if
+
+using std::string;
+using std::vector;
+
+struct Test {
+    string name;
+    void (*function) ();
+};
+
+int main (int argc, char** argv) {
+    string filter = (argc > 1) ? argv[1] : "";
+    std::signal(SIGABRT, test::TempFilesRemove);
+    vector<Test> tests = {
+        {"givenUnformattedText_whenRemovedWhitespace_returnCleanText", test::givenUnformattedText_whenRemovedWhitespace_returnCleanText},
+        {"givenRandomInstructions_whenSplit_checkIfSegmentsMatchTheInsertingSplitter", test::givenRandomInstructions_whenSplit_checkIfSegmentsMatchTheInsertingSplitter},
+        {"givenVariableInstruction_whenInstructionIsInterpreted_checkIfVariableChanged", test::givenVariableInstruction_whenInstructionIsInterpreted_checkIfVariableChanged},
+        {"givenConditionInstruction_whenInstructionIsInterpreted_checkIfTrue", test::givenConditionInstruction_whenInstructionIsInterpreted_checkIfTrue},
+        {"givenMixedOperands_whenEvaluated_checkIfStringsAndNumbersKeepTheirType", test::givenMixedOperands_whenEvaluated_checkIfStringsAndNumbersKeepTheirType},
+        {"givenTwoEngines_whenVariablesAndRandomAreUsed_checkIfStatesAreIndependent", test::givenTwoEngines_whenVariablesAndRandomAreUsed_checkIfStatesAreIndependent},
+        {"givenTwoStatesOfOneFile_whenCreated_checkIfScriptIsShared", test::givenTwoStatesOfOneFile_whenCreated_checkIfScriptIsShared},
+        {"givenChangedFile_whenHotReloaded_checkIfPositionIsKept", test::givenChangedFile_whenHotReloaded_checkIfPositionIsKept},
+        {"givenRendererSink_whenStepsAreInterpreted_checkIfChangedTextsAreReported", test::givenRendererSink_whenStepsAreInterpreted_checkIfChangedTextsAreReported},
+        {"givenScriptWithComments_whenPositionsAreReported_checkIfLinesAndColumnsMatchTheFile", test::givenScriptWithComments_whenPositionsAreReported_checkIfLinesAndColumnsMatchTheFile},
+        {"givenIncludedChapter_whenJumpedTo_checkIfItIsLoadedLazilyAndReturnedFrom", test::givenIncludedChapter_whenJumpedTo_checkIfItIsLoadedLazilyAndReturnedFrom},
+        {"givenPrefetchedBranch_whenAdopted_checkIfItMatchesDirectInterpretation", test::givenPrefetchedBranch_whenAdopted_checkIfItMatchesDirectInterpretation},
+        {"givenPlayedSteps_whenBacktracked_checkIfEarlierStepIsRestored", test::givenPlayedSteps_whenBacktracked_checkIfEarlierStepIsRestored},
+        {"givenLongPlaythrough_whenSnapshotted_checkIfFullChunksAreShared", test::givenLongPlaythrough_whenSnapshotted_checkIfFullChunksAreShared},
+        {"givenWarmedUpLoop_whenStepsAreInterpreted_checkIfNothingIsAllocated", test::givenWarmedUpLoop_whenStepsAreInterpreted_checkIfNothingIsAllocated},
+        {"givenConstantConditions_whenCompiled_checkIfTheyAreFoldedAndSkipped", test::givenConstantConditions_whenCompiled_checkIfTheyAreFoldedAndSkipped},
+        {"givenCurrentStatus_whenCheckCurrentStatus_checkIfTrue", test::givenCurrentStatus_whenCheckCurrentStatus_checkIfTrue},
+        {"givenWaitInstruction_whenTimeElapses_checkIfInterpretationResumes", test::givenWaitInstruction_whenTimeElapses_checkIfInterpretationResumes},
+        {"givenTestFile_whenInterpreted_returnInterpretedText", test::givenTestFile_whenInterpreted_returnInterpretedText},
+        {"givenTestFile_whenInterpretedThenSavedAndLoaded_checkIfStateIsTheSameAsBefore", test::givenTestFile_whenInterpretedThenSavedAndLoaded_checkIfStateIsTheSameAsBefore},
+        {"givenScriptInMemory_whenSavedAndLoadedAsText_checkIfMalformedSavesAreRejected", test::givenScriptInMemory_whenSavedAndLoadedAsText_checkIfMalformedSavesAreRejected},
+        {"givenRandomBeforeFirstWait_whenSavedAndLoaded_checkIfDrawsAreReplayed", test::givenRandomBeforeFirstWait_whenSavedAndLoaded_checkIfDrawsAreReplayed}
+    };
+
+    u32 run_c = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    for (Test& test : tests) {
+        if (test.name.find(filter) == string::npos) { continue; }
+        auto testStartTime = std::chrono::steady_clock::now();
+        test.function();
+        double time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - testStartTime).count();
+        std::cerr<<"[ OK ] "<<test.name<<" ("<<std::fixed<<std::setprecision(1)<<time_ms<<" ms)\n";
+        run_c++;
+    }
+    double time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    std::cerr<<run_c<<" of "<<tests.size()<<" tests passed in "<<std::fixed<<std::setprecision(1)<<time_ms<<" ms\n";
+    return (run_c != 0) ? 0 : 1;
+}
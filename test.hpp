@@ -6,9 +6,39 @@
 
 
 #include <cassert>
+#include <csignal>
 #include "dial.hpp"
 
+extern std::atomic<unsigned long long> HeapAllocation_c; /* counted by heapcount.hpp, which test.cpp includes */
+
 namespace test {
+    /* files the tests write; they are removed when the test ends or, from the SIGABRT handler, when one of its asserts fails */
+    std::vector<std::string> TempFiles;
+
+    void TempFilesRemove (int) {
+        for (const std::string& path : TempFiles) { remove(path.c_str()); }
+    }
+
+    void TempFileWrite (const std::string& path, const char* text) {
+        FILE* file = fopen(path.c_str(), "wb");
+        assert(file != nullptr);
+        bool isWritten = fputs(text, file) >= 0;
+        fclose(file);
+        assert(isWritten);
+    }
+
+    struct TempFile {
+        std::string path;
+        TempFile (const std::string& path, const char* text = nullptr) : path(path) { /* without a text it only removes what the test makes create */
+            TempFiles.push_back(path);
+            if (text != nullptr) { TempFileWrite(path, text); }
+        }
+        ~TempFile () {
+            remove(path.c_str());
+            TempFiles.erase(std::find(TempFiles.begin(), TempFiles.end(), path));
+        }
+    };
+
     /* unit tests */
 	void givenUnformattedText_whenRemovedWhitespace_returnCleanText () {
         std::string unformattedText = "\t  testing  test\n\rt\text  123  \n\t ";
@@ -18,6 +48,76 @@ namespace test {
         std::string expectedValue = "testing test text 123 ";
         assert(value == expectedValue);
     }
+    std::vector<std::string> InsertingSplitInstrSegments (std::string instrText) { /* the splitter SplitInstrSegments replaced, it spaced the text by inserting into it */
+        std::vector<std::string> segments;
+        u32 i = 0;
+        u32 instrText_s = instrText.size();
+        while (i + 1 < instrText_s) {
+            if ((instrText[i] == '(' && instrText[i + 1] != ' ') || 
+                (instrText[i] != ' ' && instrText[i] != '!' && instrText[i + 1] == '(') || 
+                (i + 2 < instrText_s && instrText[i] != ' ' && instrText[i + 1] == '!' && instrText[i + 2] == '(') || 
+                (instrText[i] != ' ' && instrText[i + 1] == ')') || 
+                (instrText[i] == ')' && instrText[i + 1] != ' ') || 
+                (instrText[i] != ' ' && instrText[i + 1] == ',') || 
+                (instrText[i] == ',' && instrText[i + 1] != ' ')) {
+                instrText.insert(i + 1, " ");
+                instrText_s++;
+            }
+            i++;
+        }
+        if (instrText.size() != 0 && instrText.back() == ' ') {
+            instrText.pop_back();
+        }
+        i = 0; instrText_s = instrText.size(); 
+        std::string segmentText_b = ""; 
+        while (true) {
+            while (i != instrText_s && instrText[i] != ' ' && instrText[i] != '"') {
+                segmentText_b += instrText[i];
+                i++;
+            }
+            if (i != instrText_s && instrText[i] == '"') {
+                segmentText_b += instrText[i];
+                i++;
+                while (i != instrText_s && instrText[i] != '"') {
+                    segmentText_b += instrText[i];
+                    i++;
+                }
+                if (i != instrText_s) {
+                    segmentText_b += instrText[i];
+                    i++;
+                    if (i != instrText_s && instrText[i] != ' ') {
+                        continue;
+                    }
+                }
+            }
+            segments.push_back(segmentText_b);
+            segmentText_b = "";
+            if (i == instrText_s) { break; }
+            i++;
+        }
+        return segments;
+    }
+
+    void givenRandomInstructions_whenSplit_checkIfSegmentsMatchTheInsertingSplitter () {
+        const char symbols[] = "ab1-!(),\" =+<AND";
+        u32 random = 12345;
+        std::vector<std::string> segments;
+        
+        bool value = true;
+        for (u32 n = 0; n < 20000 && value; n++) {
+            std::string instrText = "";
+            random = random * 1103515245 + 12345;
+            u32 instrText_s = (random >> 16) % 24;
+            for (u32 i = 0; i < instrText_s; i++) {
+                random = random * 1103515245 + 12345;
+                instrText += symbols[(random >> 16) % (sizeof(symbols) - 1)];
+            }
+            dial::SplitInstrSegments(instrText, segments); /* reusing the strings of the previous split */
+            value = (segments == InsertingSplitInstrSegments(instrText));
+        }
+        
+        assert(value == true);
+    }
     void givenVariableInstruction_whenInstructionIsInterpreted_checkIfVariableChanged () {
         dial::State* state = dial::State_I("unit");
         std::string variableInstruction = "testVariable = (50 + TRUE + FALSE) * 2";
@@ -37,6 +137,49 @@ namespace test {
         
         State_D(state);
         assert(value == true);
+    }
+    void givenMixedOperands_whenEvaluated_checkIfStringsAndNumbersKeepTheirType () {
+        dial::State* state = dial::State_I("unit");
+        
+        dial::VarInstrInterpret(state, "text = \"dia\" + STR(LEN(\"abcd\") * 2) + SUBSTR(\"ologue\", 0, 2)");
+        dial::VarInstrInterpret(state, "empty = \"\"");
+        dial::VarInstrInterpret(state, "number = empty + 1");
+        bool isEmptyLiteralString = dial::CondInstrInterpret(state, "empty == \"\" AND \"\" != \"x\"");
+        
+        bool value = dial::GetValue(state, "text").second == "dia8ol" && dial::GetValue(state, "number").first == 1 && isEmptyLiteralString;
+        State_D(state);
+        assert(value == true);
+    }
+    void givenTwoEngines_whenVariablesAndRandomAreUsed_checkIfStatesAreIndependent () {
+        dial::Engine* engineA = dial::Engine_I();
+        dial::Engine* engineB = dial::Engine_I();
+        dial::State* stateA = dial::State_I("unit", engineA);
+        dial::State* stateB = dial::State_I("unit", engineB);
+        dial::SeedRandom(stateA, 42);
+        dial::SeedRandom(stateB, 42);
+        
+        dial::VarInstrInterpret(stateA, "Shared = 7");
+        bool areVarsSeparate = (dial::GetValue(stateB, "Shared").first == 0);
+        bool areRandomsEqual = true;
+        for (u32 i = 0; i < 10; i++) {
+            areRandomsEqual = areRandomsEqual && (dial::GetValue(stateA, "RANDOM").first == dial::GetValue(stateB, "RANDOM").first);
+        }
+        
+        State_D(stateA);
+        State_D(stateB);
+        dial::Engine_D(engineA);
+        dial::Engine_D(engineB);
+        assert(areVarsSeparate && areRandomsEqual);
+    }
+    void givenTwoStatesOfOneFile_whenCreated_checkIfScriptIsShared () {
+        dial::State* stateA = dial::State_I("unit");
+        dial::State* stateB = dial::State_I("unit");
+        
+        bool value = (stateA->script == stateB->script && stateA->script->ref_c == 2 && stateA->script->jumpBasePos.size() == 2);
+        
+        State_D(stateA);
+        State_D(stateB);
+        assert(value == true);
     }
 	void givenCurrentStatus_whenCheckCurrentStatus_checkIfTrue () {
 		dial::State* state = dial::State_I("unit");
@@ -46,6 +189,250 @@ namespace test {
         State_D(state);
         assert(value == true);
 	}
+    void givenWaitInstruction_whenTimeElapses_checkIfInterpretationResumes () {
+        dial::State* state = dial::State_I("unit");
+        
+        dial::SpecInstrInterpret(state, "WAIT 500");
+        bool isWaiting = dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_TIME);
+        dial::TimeElapse(state, 0.25);
+        bool isStillWaiting = dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_TIME);
+        dial::TimeElapse(state, 0.25);
+        bool value = isWaiting && isStillWaiting && dial::IsCurrentStatus(state, dial::Status::INTERPRET);
+        
+        State_D(state);
+        assert(value == true);
+    }
+
+    void givenRendererSink_whenStepsAreInterpreted_checkIfChangedTextsAreReported () {
+        dial::Script* script = dial::ScriptLoadText("sink", "A1\n|\n{\n{C1} B1\n{C2} B2\n}\n|~");
+        dial::State* state = dial::State_I("sink");
+        dial::ScriptRelease(script);
+        dial::RenderChanges changes = {};
+        state->sink = dial::RendererSink(&changes);
+
+        dial::Dialogue_T(state);
+        bool isTextReported = changes.isChanged && changes.firstChanged_i == 0;
+        changes.isChanged = false;
+        dial::Continuation(state);
+        dial::Dialogue_T(state);
+        bool areChoicesReported = changes.isChanged && changes.firstChanged_i == 1;
+        changes.isChanged = false;
+        dial::Choice(state, 0);
+        bool isReplacementReported = changes.isChanged && changes.firstChanged_i == 0;
+        dial::Continuation(state);
+        dial::Dialogue_T(state);
+        dial::Dialogue_T(state);
+        bool value = isTextReported && areChoicesReported && isReplacementReported && changes.isFinished;
+
+        State_D(state);
+        assert(value == true);
+    }
+
+    void givenChangedFile_whenHotReloaded_checkIfPositionIsKept () {
+        bool areScriptsMapped = dial::AreScriptsMapped;
+        dial::AreScriptsMapped = false;
+        TempFile file("reload.dial", "A1\n|\n[[1]]\nA2\n|\nA3\n|~");
+        dial::State* state = dial::State_I("reload");
+        
+        dial::Dialogue_T(state);
+        dial::Continuation(state);
+        dial::Dialogue_T(state);
+        TempFileWrite(file.path, "A0\n|\nA1\n|\n[[1]]\nA2\n|\nB3\n|~");
+        bool isReloaded = dial::ScriptReload("reload") && dial::HotReload(state);
+        dial::Continuation(state);
+        dial::Dialogue_T(state);
+        bool value = isReloaded && state->textObjs->back().text.find("B3") != std::string::npos;
+        
+        State_D(state);
+        dial::AreScriptsMapped = areScriptsMapped;
+        assert(value == true);
+    }
+
+    void givenScriptWithComments_whenPositionsAreReported_checkIfLinesAndColumnsMatchTheFile () {
+        dial::Script* script = dial::ScriptLoadText("lines", "A1\n/* one\ntwo */\n\nA2 text\n|~");
+        std::string text = "A1\n/* one\ntwo */\n\nA2 text\n|~";
+        bool value = dial::GetCurrentTextFilePos(script, 0) == "(Line:1, Col:1)"
+                  && dial::GetCurrentTextFilePos(script, text.find("A2") + 3) == "(Line:5, Col:4)"
+                  && dial::GetCurrentTextFilePos(script, text.find("|~")) == "(Line:6, Col:1)"
+                  && dial::GetCurrentTextFilePos(script, text.find("A2")) == dial::GetCurrentTextFilePos(std::string(text).data(), text.find("A2"))
+                  && script->text == text && script->comments.size() == 1
+                  && script->comments[0] == std::make_pair((u32)text.find("/*"), (u32)text.find("*/") + 2)
+                  && dial::CommentEnd(script, text.find("/*")) == text.find("*/") + 2;
+
+        dial::ScriptRelease(script);
+        assert(value == true);
+    }
+
+    void givenIncludedChapter_whenJumpedTo_checkIfItIsLoadedLazilyAndReturnedFrom () {
+        TempFile chapterA("chapter_a.dial", "A1\n|\n@INCLUDE chapter_b@[7]\nA2\n|\n[chapter_b:8]\nA3\n|~");
+        TempFile chapterB("chapter_b.dial", "[[7]]\nB1\n|\n[~]\n[[8]]\nB2\n|\n[~]\n|~");
+        TempFile manifestOnDisk(dial::DIAL_BASES_MANIFEST);
+        dial::State* state = dial::State_I("chapter_a");
+        bool wasLoadedLazily = dial::Scripts.count("chapter_b") == 0 && state->script->linkedBases.count(7) != 0;
+        
+        for (u32 i = 0; i < 6; i++) {
+            dial::Dialogue_T(state);
+            dial::Continuation(state);
+        }
+        std::string value = "";
+        for (u32 i = 0; i < state->textObjs->size(); i++) {
+            value += (*state->textObjs)[i].text;
+        }
+        
+        State_D(state);
+        dial::ChapterCacheClear();
+        FILE* manifestFile = fopen(dial::DIAL_BASES_MANIFEST, "rb");
+        bool isWrittenUnasked = manifestFile != nullptr;
+        if (manifestFile != nullptr) { fclose(manifestFile); }
+        dial::AreBasesManifestsWritten = true;
+        dial::BasesManifests.clear(); /* scanned again, then read back from the file */
+        State_D(state = dial::State_I("chapter_a"));
+        dial::BasesManifests.clear();
+        state = dial::State_I("chapter_a");
+        dial::AreBasesManifestsWritten = false;
+        std::map<std::string, dial::LinkedFile>& manifest = dial::BasesManifests[dial::DIAL_BASES_MANIFEST];
+        bool isManifestWritten = manifest.count("chapter_b") != 0 && manifest["chapter_b"].bases == std::vector<u32>{7, 8};
+        State_D(state);
+        manifest["chapter_b"].bases = {9}; /* the unchanged file isn't read again */
+        state = dial::State_I("chapter_a");
+        bool isManifestUsed = state->script->linkedBases.count(9) != 0 && state->script->linkedBases.count(7) == 0;
+        State_D(state);
+        dial::BasesManifests.clear();
+        std::string name;
+        bool isNextToFile = dial::BasesManifestPath("chapters/chapter_b", name) == std::string("chapters/") + dial::DIAL_BASES_MANIFEST && name == "chapter_b";
+        assert(wasLoadedLazily && value == "A1 B1 A2 B2 A3 " && !isWrittenUnasked && isManifestWritten && isManifestUsed && isNextToFile);
+    }
+
+    void givenPrefetchedBranch_whenAdopted_checkIfItMatchesDirectInterpretation () {
+        dial::Engine* engine = dial::Engine_I();
+        dial::Engine* prefetchEngine = dial::Engine_I();
+        dial::State* state = dial::State_I("unit", engine);
+        dial::State* prefetchedState = dial::State_I("unit", prefetchEngine);
+        dial::SeedRandom(state, 7);
+        dial::SeedRandom(prefetchedState, 7);
+        
+        dial::Dialogue_T(state);
+        dial::Dialogue_T(prefetchedState);
+        dial::Prefetch* prefetch = dial::Prefetch_I(prefetchedState);
+        while (!prefetch->isReady) {
+            std::this_thread::yield();
+        }
+        bool wasAdopted = dial::PrefetchAdopt(prefetch, prefetchedState, 0);
+        dial::Continuation(state);
+        dial::Dialogue_T(state);
+        bool value = wasAdopted && prefetchedState->currentPos.text_i == state->currentPos.text_i
+                  && prefetchedState->textObjs->back().text == state->textObjs->back().text && prefetchedState->engine == prefetchEngine;
+        
+        dial::Prefetch_D(prefetch);
+        State_D(state);
+        State_D(prefetchedState);
+        dial::Engine_D(engine);
+        dial::Engine_D(prefetchEngine);
+        assert(value == true);
+    }
+
+    void givenPlayedSteps_whenBacktracked_checkIfEarlierStepIsRestored () {
+        dial::State* state = dial::State_I("unit");
+        
+        std::vector<std::string> shownTexts;
+        std::vector<int> testValues;
+        for (u32 i = 0; i < 5; i++) {
+            dial::Dialogue_T(state);
+            shownTexts.push_back(state->textObjs->back().text);
+            testValues.push_back(dial::GetValue(state, "Test").first);
+            dial::Continuation(state);
+        }
+        dial::Dialogue_T(state);
+        dial::LoadBacktrackState(state, 4);
+        bool isRestored = state->textObjs->back().text == shownTexts[1] && dial::GetValue(state, "Test").first == testValues[1]
+                       && dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_CONTINUATION);
+        dial::Continuation(state);
+        dial::Dialogue_T(state);
+        dial::GetValue(state, "TRUE");
+        dial::GetValue(state, "-Test");
+        bool isVarsShared = state->engine->vars.shared == state->backtrack->back().vars.shared; /* reading doesn't copy the map a snapshot holds */
+        bool value = isRestored && state->textObjs->back().text == shownTexts[2] && isVarsShared;
+
+        State_D(state);
+        assert(value == true);
+    }
+
+    void givenLongPlaythrough_whenSnapshotted_checkIfFullChunksAreShared () {
+        dial::Script* script = dial::ScriptLoadText("chunks", "[[1]]\nStep\n|\n[1]\n|~");
+        dial::State* state = dial::State_I("chunks");
+        dial::ScriptRelease(script);
+        state->sink = dial::NullSink();
+
+        for (u32 i = 0; i < 150; i++) {
+            dial::Dialogue_T(state);
+            dial::Continuation(state);
+        }
+        dial::Dialogue_T(state);
+        const dial::Snapshot& older = (*state->backtrack)[state->backtrack->size() - 20];
+        bool isShared = older.textObjs.chunks->front().shared == state->textObjs.chunks->front().shared
+                     && older.textObjs.chunks->at(1).shared == state->textObjs.chunks->at(1).shared
+                     && older.jumpHistory.chunks->front().shared == state->jumpHistory.chunks->front().shared;
+        u32 older_s = older.textObjs.size();
+        u32 olderJumps_s = older.jumpHistory.size();
+        dial::LoadBacktrackState(state, 19);
+        bool value = isShared && older_s > 128 && state->textObjs.size() == older_s && state->jumpHistory.size() == olderJumps_s;
+
+        State_D(state);
+        assert(value == true);
+    }
+    
+    void givenWarmedUpLoop_whenStepsAreInterpreted_checkIfNothingIsAllocated () { /* the shown texts and the saved entries fit in their strings, so only a temporary could allocate */
+        dial::Script* script = dial::ScriptLoadText("arena", "[[1]]\n#Count++#\n&REPEAT > 2 AND (Count % 3 == 0 OR name == \"loop\")& #hits += 1# ||\n&ONCE& #name = \"lo\" + \"op\"# ||\nStep\n|\n{\n{Yes &Count % 2 == 0& now||} #yes += 1#\n&hits > 1&{No} #no += 1# ||\n}\n|\n[1]\n|~");
+        dial::State* state = dial::State_I("arena");
+        dial::ScriptRelease(script);
+        state->flags = dial::Flags::NO_BACKTRACK; /* the debug build's snapshots are kept, not temporaries */
+        state->sink = dial::NullSink(); /* the console reprints all the texts after a choice */
+        state->textObjs.reserve(1000);
+        state->jumpHistory.reserve(1000);
+        state->saveData.reserve(1000);
+        auto step = [state] (u32 step_i) {
+            if (dial::IsCurrentStatus(state, dial::Status::WAIT_FOR_CHOICE)) { dial::Choice(state, (step_i / 2) % dial::GetChoicesSize(state)); }
+            else { dial::Continuation(state); }
+            dial::Dialogue_T(state);
+        };
+
+        dial::Dialogue_T(state);
+        for (u32 i = 0; i < 40; i++) { step(i); }
+        unsigned long long heapAllocation_c = HeapAllocation_c;
+        for (u32 i = 40; i < 140; i++) { step(i); }
+        heapAllocation_c = HeapAllocation_c - heapAllocation_c;
+        bool value = heapAllocation_c == 0 && dial::GetValue(state, "hits").first > 20
+                  && dial::GetValue(state, "yes").first > 10 && dial::GetValue(state, "no").first > 10;
+        
+        State_D(state);
+        assert(value == true);
+    }
+    
+    void givenConstantConditions_whenCompiled_checkIfTheyAreFoldedAndSkipped () {
+        dial::Script* script = dial::ScriptLoadText("fold", "&(10 / 2) == (55 % 10 + 10 - 5 * 2)& A ||\n&FALSE& B #count = 9# ||\n&ELSE count < 2 * 3 + TRUE& C ||\nD\n|\n|~");
+        dial::State* state = dial::State_I("fold");
+        dial::ScriptRelease(script);
+        std::string text = state->script->text;
+        
+        const dial::Instr& alwaysTrue = state->script->instrs[0];
+        const dial::Instr& alwaysFalse = state->script->instrs[text.find("&FALSE&")];
+        const dial::Instr& folded = state->script->instrs[text.find("&ELSE")];
+        bool areFolded = alwaysTrue.staticResult == 1 && alwaysTrue.tokens.size() == 1 && alwaysFalse.staticResult == 0
+                      && alwaysFalse.skip_i == text.find("||", text.find("&FALSE&")) + 2
+                      && folded.staticResult == -1 && folded.isFolded && folded.tokens.size() == 3 && folded.tokens[1].number == 7;
+        for (u32 i = 0; i < 3; i++) {
+            dial::Dialogue_T(state);
+            dial::Continuation(state);
+        }
+        std::string shownText = "";
+        for (u32 i = 0; i < state->textObjs->size(); i++) {
+            shownText += (*state->textObjs)[i].text;
+        }
+        bool value = areFolded && shownText == "A C D " && dial::GetValue(state, "count").first == 0;
+        
+        State_D(state);
+        assert(value == true);
+    }
     
     /* integration tests */
     void givenTestFile_whenInterpreted_returnInterpretedText () {
@@ -56,8 +443,8 @@ namespace test {
             dial::Continuation(state);
         }
         std::string value = "";
-        for (u32 i = 0; i < state->textObjs.size(); i++) {
-            value += state->textObjs[i].text;
+        for (u32 i = 0; i < state->textObjs->size(); i++) {
+            value += (*state->textObjs)[i].text;
         }
         
         std::string expectedValue = "Test 1 Test 2 Test 3 Test 4 Test 5 Test 6 Test 7 Test 8 Test 9 ";
@@ -74,8 +461,8 @@ namespace test {
         dial::StateSave(state, 0);
 		dial::State* loadedState = dial::StateLoad("unit", 0); 
 		std::string value = "";
-        for (u32 i = 0; i < loadedState->textObjs.size(); i++) {
-            value += loadedState->textObjs[i].text;
+        for (u32 i = 0; i < loadedState->textObjs->size(); i++) {
+            value += (*loadedState->textObjs)[i].text;
         }
         
         std::string expectedValue = "Test 1 Test 2 Test 3 Test 5 Test 6 Test 7 ";
@@ -83,6 +470,46 @@ namespace test {
         State_D(loadedState);
 		assert(value == expectedValue);
     }
+
+    void givenScriptInMemory_whenSavedAndLoadedAsText_checkIfMalformedSavesAreRejected () {
+        dial::Script* script = dial::ScriptLoadText("memory", "A1\n|\n#count = 7 % 0#\n#count += 2#\nA2\n|~");
+        dial::State* state = dial::State_I("memory");
+        dial::ScriptRelease(script);
+
+        dial::Dialogue_T(state);
+        dial::Continuation(state);
+        dial::Dialogue_T(state);
+        dial::State* loadedState = dial::StateLoadText(dial::StateSaveText(state), "memory");
+        bool isLoaded = loadedState != nullptr && loadedState->textObjs->size() == 2 && dial::GetVarValue(loadedState, "count", false).first == 2;
+        bool areMalformedRejected = dial::StateLoadText("", "empty") == nullptr && dial::StateLoadText("f,", "short") == nullptr;
+        dial::State* shortEntryState = dial::StateLoadText("f:memory,v,", "entry");
+        bool value = isLoaded && areMalformedRejected && shortEntryState == nullptr;
+
+        State_D(state);
+        State_D(loadedState);
+        assert(value == true);
+    }
+
+    void givenRandomBeforeFirstWait_whenSavedAndLoaded_checkIfDrawsAreReplayed () {
+        dial::Script* script = dial::ScriptLoadText("replay", "#value = RANDOM# #other = RANDOM# A\n|\n#next = RANDOM# B\n|~");
+        dial::State* state = dial::State_I("replay");
+        dial::ScriptRelease(script);
+
+        dial::Dialogue_T(state);
+        dial::Continuation(state);
+        dial::Dialogue_T(state);
+        std::string saveText = dial::StateSaveText(state);
+        dial::State* loadedState = dial::StateLoadText(saveText, "replay");
+        bool value = loadedState != nullptr;
+        for (const char* var : {"value", "other", "next"}) {
+            value = value && dial::GetVarValue(loadedState, var, false).first == dial::GetVarValue(state, var, false).first;
+        }
+        value = value && dial::StateSaveText(loadedState) == saveText; /* saved again, it keeps the seed */
+
+        State_D(state);
+        State_D(loadedState);
+        assert(value == true);
+    }
 }
 
 #undef u32
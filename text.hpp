@@ -13,33 +13,39 @@ namespace text {
         Color color;
         Vec3 lastCharPos;
         u32 length;
+        float revealSpeed; /* glyphs per second for the typewriter reveal, 0 shows the whole text at once */
+        float revealTime;
         GLuint vao, vbo, ebo, tex, program;
     };
 
     int utf8IndexFromCodePoint (char32_t codepoint);
     std::basic_string<char32_t> convertStr8ToStr32 (std::string str8);
 
-    Text* Text_I (font::Font* font, std::string str8) {
-        Text* text = new Text();
-        text->transform = MAT4_IDENTITY;
-        text->color = { 0.0f, 0.0f, 0.0f, 1.0f };
-        text->lastCharPos = { 0.0f, 0.0f, 0.0f };
-        text->length = 0;
-        text->vao = 0; text->vbo = 0; text->ebo = 0, text->tex = 0; text->program = font::Shader.program_id;
-        if (font == nullptr) { return text; }
+    struct Layout { /* glyph vertices built on the CPU only, so any thread can prepare them before Text_I uploads them */
+        std::vector<float> points;
+        std::vector<u32> indices;
+        Vec3 lastCharPos;
+        u32 length;
+    };
+
+    Layout LayoutBuild (font::Font* font, std::string str8) {
+        Layout layout;
+        layout.lastCharPos = { 0.0f, 0.0f, 0.0f };
+        layout.length = 0;
+        if (font == nullptr) { return layout; }
         u32 lineBreak_c = 0;
 
         std::basic_string<char32_t> str32 = convertStr8ToStr32(str8);
-        text->length = str32.length();
+        layout.length = str32.length();
         /* @TODO check here which unicode characters from the text aren't in the font atlas */
         
         float x = 0, y = 0, xStart = 0, yStart = 0;
 
-        float points[4 * 5 * text->length]; int p_i = 0;
-        u32 indices[2 * 3 * text->length]; int i_i = 0;
+        std::vector<float>& points = layout.points; points.resize(4 * 6 * layout.length); int p_i = 0;
+        std::vector<u32>& indices = layout.indices; indices.resize(2 * 3 * layout.length); int i_i = 0;
         const int textOffsetY = font->size/2;
         
-        for (u32 i = 0; i < text->length; i++) {
+        for (u32 i = 0; i < layout.length; i++) {
             int char_i = utf8IndexFromCodePoint(str32[i]) - 32; /* 32 because it is ascii index of first character (which is space) */
             if (char_i < 0 || char_i >= font::FONT_RANGE) { char_i = 0; }
 
@@ -47,10 +53,10 @@ namespace text {
             stbtt_GetPackedQuad(font->charData, font->atlasSize, font->atlasSize, char_i, &x, &y, &q, 1);
             /* q.x0, q.x1, q.y0 and q.y1 are in pixels */
 
-            points[p_i++] = q.x0; points[p_i++] = -(q.y0 + textOffsetY); points[p_i++] = 0.0f; points[p_i++] = q.s0; points[p_i++] = q.t0; /* top left */
-            points[p_i++] = q.x1; points[p_i++] = -(q.y0 + textOffsetY); points[p_i++] = 0.0f; points[p_i++] = q.s1; points[p_i++] = q.t0; /* top right */
-            points[p_i++] = q.x1; points[p_i++] = -(q.y1 + textOffsetY); points[p_i++] = 0.0f; points[p_i++] = q.s1; points[p_i++] = q.t1; /* bot right */
-            points[p_i++] = q.x0; points[p_i++] = -(q.y1 + textOffsetY); points[p_i++] = 0.0f; points[p_i++] = q.s0; points[p_i++] = q.t1; /* bot left */
+            points[p_i++] = q.x0; points[p_i++] = -(q.y0 + textOffsetY); points[p_i++] = 0.0f; points[p_i++] = q.s0; points[p_i++] = q.t0; points[p_i++] = (float)i; /* top left */
+            points[p_i++] = q.x1; points[p_i++] = -(q.y0 + textOffsetY); points[p_i++] = 0.0f; points[p_i++] = q.s1; points[p_i++] = q.t0; points[p_i++] = (float)i; /* top right */
+            points[p_i++] = q.x1; points[p_i++] = -(q.y1 + textOffsetY); points[p_i++] = 0.0f; points[p_i++] = q.s1; points[p_i++] = q.t1; points[p_i++] = (float)i; /* bot right */
+            points[p_i++] = q.x0; points[p_i++] = -(q.y1 + textOffsetY); points[p_i++] = 0.0f; points[p_i++] = q.s0; points[p_i++] = q.t1; points[p_i++] = (float)i; /* bot left */
 
             indices[i_i++] = 0 + i*4; indices[i_i++] = 1 + i*4; indices[i_i++] = 2 + i*4; /* top right triangle */
             indices[i_i++] = 2 + i*4; indices[i_i++] = 3 + i*4; indices[i_i++] = 0 + i*4; /* bot left triangle */
@@ -61,6 +67,23 @@ namespace text {
                 y = yStart + font->size * lineBreak_c; /* @TODO can set line height here */
             }
         }
+        layout.lastCharPos = {x, -y, 0.0f};
+        return layout;
+    }
+
+    Text* Text_I (font::Font* font, const Layout& layout) { /* uploads the layout, has to be called on the thread with the GL context */
+        Text* text = new Text();
+        text->transform = MAT4_IDENTITY;
+        text->color = { 0.0f, 0.0f, 0.0f, 1.0f };
+        text->lastCharPos = { 0.0f, 0.0f, 0.0f };
+        text->length = 0;
+        text->revealSpeed = 0.0f;
+        text->revealTime = 0.0f;
+        text->vao = 0; text->vbo = 0; text->ebo = 0, text->tex = 0; text->program = font::Shader.program_id;
+        if (font == nullptr) { return text; }
+        text->length = layout.length;
+        const float* points = layout.points.data();
+        const u32* indices = layout.indices.data();
 
         GLuint vao = 0;
         glGenVertexArrays(1, &vao);
@@ -69,7 +92,7 @@ namespace text {
         GLuint vbo = 0;
         glGenBuffers(1, &vbo);
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, 4 * 5 * text->length * sizeof(float), points, GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, 4 * 6 * text->length * sizeof(float), points, GL_STATIC_DRAW);
 
         GLuint ebo = 0;
         glGenBuffers(1, &ebo);
@@ -77,9 +100,11 @@ namespace text {
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, 2 * 3 * text->length * sizeof(u32), indices, GL_STATIC_DRAW);
 
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0); /* position data */
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0); /* position data */
         glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float))); /* texture data */
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float))); /* texture data */
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(5 * sizeof(float))); /* glyph index, compared against the reveal count in the shader */
 
         /* resetting section */
         glBindVertexArray(0);
@@ -87,12 +112,17 @@ namespace text {
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
         glDisableVertexAttribArray(0);
         glDisableVertexAttribArray(1);
+        glDisableVertexAttribArray(2);
 
-        text->lastCharPos = {x, -y, 0.0f};
+        text->lastCharPos = layout.lastCharPos;
         text->vao = vao; text->vbo = vbo; text->ebo = ebo; text->tex = font->tex;
         return text;
     }
 
+    Text* Text_I (font::Font* font, std::string str8) {
+        return Text_I(font, LayoutBuild(font, str8));
+    }
+
     void Text_D (Text*& text) {
         if (text == nullptr) { return; }
 
@@ -103,6 +133,22 @@ namespace text {
         text = nullptr;
     }
     
+    /* typewriter reveal; the mesh is built once and only the uReveal uniform changes between frames */
+    void Reveal (Text* text, double deltaTime) {
+        if (text == nullptr) { return; }
+        text->revealTime += (float)deltaTime;
+    }
+
+    bool IsRevealed (Text* text) {
+        if (text == nullptr) { return true; }
+        return (text->revealSpeed <= 0.0f || text->revealTime * text->revealSpeed >= (float)text->length + 1.0f);
+    }
+
+    void RevealAll (Text* text) {
+        if (text == nullptr) { return; }
+        text->revealSpeed = 0.0f;
+    }
+    
     void Draw (Text* text) {
         glUseProgram(text->program);
 
@@ -120,6 +166,9 @@ namespace text {
         GLint uniformLocationColor = glGetUniformLocation(text->program, "uColor");
         glUniform4f(uniformLocationColor, text->color.r, text->color.g, text->color.b, text->color.a);
 
+        GLint uniformLocationReveal = glGetUniformLocation(text->program, "uReveal");
+        glUniform1f(uniformLocationReveal, IsRevealed(text) ? (float)text->length + 1.0f : text->revealTime * text->revealSpeed);
+
         glBindVertexArray(text->vao);
         glBindBuffer(GL_ARRAY_BUFFER, text->vbo);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, text->ebo);